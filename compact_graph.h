@@ -0,0 +1,128 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    // Неизменяемый граф в формате CSR: исходящие рёбра вершины v занимают позиции
+    // [offsets[v], offsets[v + 1]) в массивах edge_ids, targets и weights. Идентификаторы рёбер
+    // совпадают с идентификаторами в DirectedWeightedGraph, из которого граф построен.
+    template <typename Weight>
+    class CompactGraph {
+    public:
+        using Index = uint32_t;
+        using IncidentEdgesRange = ranges::Range<const Index*>;
+
+        CompactGraph() = default;
+        explicit CompactGraph(const DirectedWeightedGraph<Weight>& graph);
+
+        size_t GetVertexCount() const;
+        size_t GetEdgeCount() const;
+        Edge<Weight> GetEdge(EdgeId edge_id) const;
+        IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+
+        // Доступ к исходящим рёбрам по позициям, без обращения к рёбрам по идентификатору
+        size_t GetFirstSlot(VertexId vertex) const;
+        size_t GetLastSlot(VertexId vertex) const;
+        EdgeId GetSlotEdgeId(size_t slot) const;
+        VertexId GetSlotTarget(size_t slot) const;
+        Weight GetSlotWeight(size_t slot) const;
+
+    private:
+        std::vector<Index> offsets_;
+        std::vector<Index> edge_ids_;
+        std::vector<Index> targets_;
+        std::vector<Weight> weights_;
+
+        // По идентификатору ребра - начало ребра и его позиция в массивах выше
+        std::vector<Index> sources_;
+        std::vector<Index> slots_;
+    };
+
+    template <typename Weight>
+    using CompactGraphPtr = std::shared_ptr<const CompactGraph<Weight>>;
+
+    template <typename Weight>
+    CompactGraph<Weight>::CompactGraph(const DirectedWeightedGraph<Weight>& graph) {
+        const size_t vertex_count = graph.GetVertexCount();
+        const size_t edge_count = graph.GetEdgeCount();
+        if (vertex_count >= std::numeric_limits<Index>::max() || edge_count >= std::numeric_limits<Index>::max()) {
+            throw std::length_error("Graph is too large for 32-bit ids");
+        }
+
+        offsets_.reserve(vertex_count + 1);
+        edge_ids_.reserve(edge_count);
+        targets_.reserve(edge_count);
+        weights_.reserve(edge_count);
+        sources_.assign(edge_count, 0);
+        slots_.assign(edge_count, 0);
+        offsets_.push_back(0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                sources_[edge_id] = static_cast<Index>(vertex);
+                slots_[edge_id] = static_cast<Index>(edge_ids_.size());
+                edge_ids_.push_back(static_cast<Index>(edge_id));
+                targets_.push_back(static_cast<Index>(edge.to));
+                weights_.push_back(edge.weight);
+            }
+            offsets_.push_back(static_cast<Index>(edge_ids_.size()));
+        }
+        if (edge_ids_.size() != edge_count) {
+            throw std::invalid_argument("Incidence lists don't cover all edges");
+        }
+    }
+
+    template <typename Weight>
+    size_t CompactGraph<Weight>::GetVertexCount() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    template <typename Weight>
+    size_t CompactGraph<Weight>::GetEdgeCount() const {
+        return edge_ids_.size();
+    }
+
+    template <typename Weight>
+    Edge<Weight> CompactGraph<Weight>::GetEdge(EdgeId edge_id) const {
+        const Index slot = slots_.at(edge_id);
+        return {sources_[edge_id], targets_[slot], weights_[slot]};
+    }
+
+    template <typename Weight>
+    typename CompactGraph<Weight>::IncidentEdgesRange CompactGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+        return {edge_ids_.data() + offsets_.at(vertex), edge_ids_.data() + offsets_.at(vertex + 1)};
+    }
+
+    template <typename Weight>
+    size_t CompactGraph<Weight>::GetFirstSlot(VertexId vertex) const {
+        return offsets_[vertex];
+    }
+
+    template <typename Weight>
+    size_t CompactGraph<Weight>::GetLastSlot(VertexId vertex) const {
+        return offsets_[vertex + 1];
+    }
+
+    template <typename Weight>
+    EdgeId CompactGraph<Weight>::GetSlotEdgeId(size_t slot) const {
+        return edge_ids_[slot];
+    }
+
+    template <typename Weight>
+    VertexId CompactGraph<Weight>::GetSlotTarget(size_t slot) const {
+        return targets_[slot];
+    }
+
+    template <typename Weight>
+    Weight CompactGraph<Weight>::GetSlotWeight(size_t slot) const {
+        return weights_[slot];
+    }
+
+}  // namespace graph
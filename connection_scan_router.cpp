@@ -0,0 +1,95 @@
+#include "connection_scan_router.h"
+
+namespace transport_router {
+
+    ConnectionScanRouter::ConnectionScanRouter(const TransportCatalogue& db, double busVelocity)
+        : busVelocity_(busVelocity) {
+        IndexCatalogue(db);
+
+        for(const Bus& bus : db.GetBuses()) {
+            for(const double departure : bus.departures_) {
+                const auto trip = static_cast<uint32_t>(tripCount_++);
+                for(size_t i = 0; i + 1 < bus.route_.size(); ++i) {
+                    connections_.push_back({bus.route_[i]->id_, bus.route_[i + 1]->id_,
+                                            departure + ComputeRideTime(bus.routeDistances_[i]),
+                                            departure + ComputeRideTime(bus.routeDistances_[i + 1]),
+                                            trip, bus.id_, static_cast<uint32_t>(i)});
+                }
+            }
+        }
+        std::stable_sort(connections_.begin(), connections_.end(), [](const Connection& lhs, const Connection& rhs) {
+            return lhs.departure < rhs.departure || (lhs.departure == rhs.departure && lhs.arrival < rhs.arrival);
+        });
+    }
+
+    ConnectionScanRouter::ConnectionScanRouter(const TransportCatalogue& db, std::vector<Connection> connections)
+        : connections_(std::move(connections)) {
+        IndexCatalogue(db);
+        for(const auto& connection : connections_) {
+            if(connection.fromStop >= stopCount_ || connection.toStop >= stopCount_ || connection.bus >= busCount_) {
+                throw std::invalid_argument("Timetable doesn't match the catalogue");
+            }
+            tripCount_ = std::max<size_t>(tripCount_, connection.trip + 1);
+        }
+    }
+
+    void ConnectionScanRouter::IndexCatalogue(const TransportCatalogue& db) {
+        stopCount_ = db.GetAllStops().size();
+        busCount_ = db.GetBuses().size();
+    }
+
+    std::optional<ConnectionScanRouter::Journey> ConnectionScanRouter::FindEarliestArrival(const Stop* from, const Stop* to,
+                                                                                           double departureTime) const {
+        const uint32_t fromIndex = from->id_;
+        const uint32_t toIndex = to->id_;
+
+        std::vector<double> earliestArrivals(stopCount_, UNREACHABLE);
+        // Для остановки - перегоны посадки и высадки последней поездки, которой до неё добрались
+        std::vector<std::pair<uint32_t, uint32_t>> inConnections(stopCount_, {NO_CONNECTION, NO_CONNECTION});
+        std::vector<uint32_t> tripBoardings(tripCount_, NO_CONNECTION);
+        earliestArrivals[fromIndex] = departureTime;
+
+        auto it = std::lower_bound(connections_.begin(), connections_.end(), departureTime, [](const Connection& connection, double time) {
+            return connection.departure < time;
+        });
+        for(; it != connections_.end() && it->departure < earliestArrivals[toIndex]; ++it) {
+            const auto index = static_cast<uint32_t>(it - connections_.begin());
+            if(tripBoardings[it->trip] == NO_CONNECTION) {
+                if(earliestArrivals[it->fromStop] > it->departure) {
+                    continue;
+                }
+                tripBoardings[it->trip] = index;
+            }
+            if(it->arrival < earliestArrivals[it->toStop]) {
+                earliestArrivals[it->toStop] = it->arrival;
+                inConnections[it->toStop] = {tripBoardings[it->trip], index};
+            }
+        }
+
+        if(earliestArrivals[toIndex] == UNREACHABLE) {
+            return std::nullopt;
+        }
+        std::vector<Leg> legs;
+        for(uint32_t stop = toIndex; stop != fromIndex;) {
+            const Connection& board = connections_[inConnections[stop].first];
+            const Connection& alight = connections_[inConnections[stop].second];
+            legs.push_back({board.bus, board.fromStop,
+                            static_cast<int>(alight.position - board.position + 1),
+                            board.departure - earliestArrivals[board.fromStop], alight.arrival - board.departure});
+            stop = board.fromStop;
+        }
+        std::reverse(legs.begin(), legs.end());
+        return Journey{earliestArrivals[toIndex] - departureTime, std::move(legs)};
+    }
+
+    const std::vector<ConnectionScanRouter::Connection>& ConnectionScanRouter::GetConnections() const {
+        return connections_;
+    }
+
+    double ConnectionScanRouter::ComputeRideTime(double distance) const {
+        double sInKm = distance / 1000;
+        double tInH = sInKm / busVelocity_;
+        return tInH * 60;
+    }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "transport_catalogue.h"
+
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace transport_router {
+
+    using transport_catalogue::Stop;
+    using transport_catalogue::Bus;
+    using transport_catalogue::TransportCatalogue;
+
+    // Поиск по расписанию алгоритмом Connection Scan. Каждый рейс автобуса разбит на перегоны между
+    // соседними остановками, все перегоны лежат в одном массиве, отсортированном по времени отправления.
+    // Запрос "выехать не раньше T и приехать как можно раньше" - один проход по этому массиву.
+    // Время отсчитывается в минутах от начала суток и через полночь не заворачивается: рейс, вышедший
+    // в 23:50, приезжает позже 1440, а запрос с T после полуночи видит только рейсы с отправлением 1440 и больше.
+    class ConnectionScanRouter {
+    public:
+        // Остановки - индексы в TransportCatalogue::GetAllStops, автобусы - в TransportCatalogue::GetBuses,
+        // position - индекс остановки отправления в маршруте автобуса
+        struct Connection {
+            uint32_t fromStop;
+            uint32_t toStop;
+            double departure;
+            double arrival;
+            uint32_t trip;
+            uint32_t bus;
+            uint32_t position;
+        };
+
+        // id автобуса и остановки посадки
+        struct Leg {
+            uint32_t bus;
+            uint32_t boardStop;
+            int spanCount;
+            double waitTime;
+            double rideTime;
+        };
+
+        struct Journey {
+            double totalTime;
+            std::vector<Leg> legs;
+        };
+
+        ConnectionScanRouter(const TransportCatalogue& db, double busVelocity);
+        ConnectionScanRouter(const TransportCatalogue& db, std::vector<Connection> connections);
+
+        [[nodiscard]] std::optional<Journey> FindEarliestArrival(const Stop* from, const Stop* to, double departureTime) const;
+
+        [[nodiscard]] const std::vector<Connection>& GetConnections() const;
+
+    private:
+        void IndexCatalogue(const TransportCatalogue& db);
+        [[nodiscard]] double ComputeRideTime(double distance) const;
+
+        static constexpr uint32_t NO_CONNECTION = std::numeric_limits<uint32_t>::max();
+        static constexpr double UNREACHABLE = std::numeric_limits<double>::infinity();
+
+        double busVelocity_ = 0.;
+        size_t stopCount_ = 0;
+        size_t busCount_ = 0;
+        std::vector<Connection> connections_;
+        size_t tripCount_ = 0;
+    };
+
+}
@@ -0,0 +1,478 @@
+#pragma once
+
+#include "router.h"
+#include "dijkstra_router.h"
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace graph {
+
+    // Иерархия сжатий: вершины сжимаются по возрастанию важности, вместо удалённых путей добавляются
+    // рёбра-сокращения. Запрос - двунаправленный Дейкстра только вверх по рангам, найденный путь
+    // раскрывается обратно в рёбра исходного графа.
+    template <typename Weight>
+    class ContractionHierarchy : public RouterBase<Weight> {
+    private:
+        using GraphPtr = CompactGraphPtr<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+        using Rank = uint32_t;
+
+        // Сокращение заменяет путь из двух рёбер дополненного графа: first, затем second.
+        // Идентификатор сокращения - число рёбер исходного графа плюс его номер.
+        struct Shortcut {
+            Edge<Weight> edge;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        explicit ContractionHierarchy(GraphPtr graph);
+        ContractionHierarchy(GraphPtr graph, std::vector<Shortcut> shortcuts, std::vector<Rank> ranks);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // Один поиск Дейкстры по исходному графу вместо запроса с раскрытием сокращений до каждой цели
+        std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+
+        const std::vector<Shortcut>& GetShortcuts() const;
+        const std::vector<Rank>& GetRanks() const;
+
+    private:
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<VertexId> touched;
+
+            void Reset(size_t vertex_count);
+            void Visit(VertexId vertex, Weight weight, EdgeId prev_edge);
+        };
+
+        class WitnessSearch;
+
+        Edge<Weight> GetAugmentedEdge(EdgeId edge_id) const;
+        void Contract();
+        void BuildSearchGraph();
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr size_t WITNESS_SETTLED_LIMIT = 50;
+
+        GraphPtr graph_;
+        std::vector<Shortcut> shortcuts_;
+        std::vector<Rank> ranks_;
+
+        // Рёбра к вершинам большего ранга: forward - исходящие из вершины, backward - входящие в неё
+        std::vector<size_t> forward_offsets_;
+        std::vector<EdgeId> forward_edges_;
+        std::vector<size_t> backward_offsets_;
+        std::vector<EdgeId> backward_edges_;
+    };
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Reset(size_t vertex_count) {
+        if (weights.size() != vertex_count) {
+            weights.assign(vertex_count, UNREACHABLE);
+            prev_edges.assign(vertex_count, NO_EDGE);
+            touched.clear();
+            return;
+        }
+        for (const VertexId vertex : touched) {
+            weights[vertex] = UNREACHABLE;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Visit(VertexId vertex, Weight weight, EdgeId prev_edge) {
+        if (weights[vertex] == UNREACHABLE) {
+            touched.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+    }
+
+    // Локальный поиск свидетеля: есть ли путь не длиннее пути через сжимаемую вершину
+    template <typename Weight>
+    class ContractionHierarchy<Weight>::WitnessSearch {
+    public:
+        WitnessSearch(const ContractionHierarchy& hierarchy, const std::vector<std::vector<EdgeId>>& out_edges)
+                : hierarchy_(hierarchy), out_edges_(out_edges) {
+        }
+
+        // Поиск останавливается, когда все целевые вершины окончательно посчитаны
+        void Run(VertexId from, VertexId excluded, Weight max_weight, const std::vector<VertexId>& targets) {
+            space_.Reset(out_edges_.size());
+            is_target_.resize(out_edges_.size(), false);
+            size_t targets_left = 0;
+            for (const VertexId target : targets) {
+                if (!is_target_[target]) {
+                    is_target_[target] = true;
+                    ++targets_left;
+                }
+            }
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+            space_.Visit(from, ZERO_WEIGHT, NO_EDGE);
+            queue.push({ZERO_WEIGHT, from});
+            size_t settled_count = 0;
+            while (!queue.empty() && settled_count < WITNESS_SETTLED_LIMIT && targets_left > 0) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > space_.weights[vertex]) {
+                    continue;
+                }
+                if (weight > max_weight) {
+                    break;
+                }
+                ++settled_count;
+                if (is_target_[vertex]) {
+                    is_target_[vertex] = false;
+                    --targets_left;
+                }
+                for (const EdgeId edge_id : out_edges_[vertex]) {
+                    const auto& edge = hierarchy_.GetAugmentedEdge(edge_id);
+                    if (edge.to == excluded) {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight + edge.weight;
+                    if (candidate_weight < space_.weights[edge.to]) {
+                        space_.Visit(edge.to, candidate_weight, edge_id);
+                        queue.push({candidate_weight, edge.to});
+                    }
+                }
+            }
+            for (const VertexId target : targets) {
+                is_target_[target] = false;
+            }
+        }
+
+        void Clear() {
+            space_.Reset(out_edges_.size());
+        }
+
+        Weight GetWeight(VertexId vertex) const {
+            return space_.weights[vertex];
+        }
+
+    private:
+        const ContractionHierarchy& hierarchy_;
+        const std::vector<std::vector<EdgeId>>& out_edges_;
+        SearchSpace space_;
+        std::vector<bool> is_target_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(GraphPtr graph)
+            : graph_(std::move(graph)), ranks_(graph_->GetVertexCount()) {
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            if (graph_->GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        Contract();
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(GraphPtr graph, std::vector<Shortcut> shortcuts,
+                                                       std::vector<Rank> ranks)
+            : graph_(std::move(graph)), shortcuts_(std::move(shortcuts)), ranks_(std::move(ranks)) {
+        if (ranks_.size() != graph_->GetVertexCount()) {
+            throw std::invalid_argument("Vertex ranks don't match the graph");
+        }
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    Edge<Weight> ContractionHierarchy<Weight>::GetAugmentedEdge(EdgeId edge_id) const {
+        const size_t edge_count = graph_->GetEdgeCount();
+        return edge_id < edge_count ? graph_->GetEdge(edge_id) : shortcuts_[edge_id - edge_count].edge;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contract() {
+        const size_t vertex_count = graph_->GetVertexCount();
+        std::vector<std::vector<EdgeId>> out_edges(vertex_count);
+        std::vector<std::vector<EdgeId>> in_edges(vertex_count);
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_->GetEdge(edge_id);
+            if (edge.from != edge.to) {
+                out_edges[edge.from].push_back(edge_id);
+                in_edges[edge.to].push_back(edge_id);
+            }
+        }
+        std::vector<bool> is_contracted(vertex_count, false);
+        std::vector<int> contracted_neighbours(vertex_count, 0);
+        WitnessSearch witness_search(*this, out_edges);
+
+        // Из параллельных рёбер в сокращения идёт только самое лёгкое
+        auto get_lightest_edges = [this](const std::vector<EdgeId>& edge_ids, bool by_source) {
+            std::vector<EdgeId> lightest(edge_ids);
+            auto end_vertex = [this, by_source](EdgeId edge_id) {
+                return by_source ? GetAugmentedEdge(edge_id).from : GetAugmentedEdge(edge_id).to;
+            };
+            std::sort(lightest.begin(), lightest.end(), [this, &end_vertex](EdgeId lhs, EdgeId rhs) {
+                return std::make_pair(end_vertex(lhs), GetAugmentedEdge(lhs).weight)
+                       < std::make_pair(end_vertex(rhs), GetAugmentedEdge(rhs).weight);
+            });
+            lightest.erase(std::unique(lightest.begin(), lightest.end(), [&end_vertex](EdgeId lhs, EdgeId rhs) {
+                return end_vertex(lhs) == end_vertex(rhs);
+            }), lightest.end());
+            return lightest;
+        };
+
+        auto find_shortcuts = [&](VertexId vertex) {
+            std::vector<Shortcut> shortcuts;
+            const std::vector<EdgeId> lightest_in = get_lightest_edges(in_edges[vertex], true);
+            const std::vector<EdgeId> lightest_out = get_lightest_edges(out_edges[vertex], false);
+            Weight max_out_weight = ZERO_WEIGHT;
+            std::vector<VertexId> targets;
+            for (const EdgeId edge_id : lightest_out) {
+                const auto& out_edge = GetAugmentedEdge(edge_id);
+                max_out_weight = std::max(max_out_weight, out_edge.weight);
+                // Свидетель возможен, только если в цель ведёт ребро не из сжимаемой вершины
+                const bool has_other_entrance = std::any_of(
+                        in_edges[out_edge.to].begin(), in_edges[out_edge.to].end(),
+                        [this, vertex](EdgeId in_edge_id) { return GetAugmentedEdge(in_edge_id).from != vertex; });
+                if (has_other_entrance) {
+                    targets.push_back(out_edge.to);
+                }
+            }
+            for (const EdgeId in_edge_id : lightest_in) {
+                const auto& in_edge = GetAugmentedEdge(in_edge_id);
+                if (targets.empty()) {
+                    witness_search.Clear();
+                } else {
+                    witness_search.Run(in_edge.from, vertex, in_edge.weight + max_out_weight, targets);
+                }
+                for (const EdgeId out_edge_id : lightest_out) {
+                    const auto& out_edge = GetAugmentedEdge(out_edge_id);
+                    if (out_edge.to == in_edge.from) {
+                        continue;
+                    }
+                    const Weight via_weight = in_edge.weight + out_edge.weight;
+                    if (witness_search.GetWeight(out_edge.to) > via_weight) {
+                        shortcuts.push_back({{in_edge.from, out_edge.to, via_weight}, in_edge_id, out_edge_id});
+                    }
+                }
+            }
+            return shortcuts;
+        };
+
+        auto get_priority = [&](VertexId vertex, size_t shortcut_count) {
+            return static_cast<int>(shortcut_count)
+                   - static_cast<int>(in_edges[vertex].size() + out_edges[vertex].size())
+                   + contracted_neighbours[vertex];
+        };
+
+        using QueueItem = std::pair<int, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.push({get_priority(vertex, find_shortcuts(vertex).size()), vertex});
+        }
+
+        Rank next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            if (is_contracted[vertex]) {
+                continue;
+            }
+            // Ленивое обновление: приоритет пересчитывается перед сжатием
+            std::vector<Shortcut> shortcuts = find_shortcuts(vertex);
+            const int priority = get_priority(vertex, shortcuts.size());
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({priority, vertex});
+                continue;
+            }
+
+            const size_t edge_count = graph_->GetEdgeCount();
+            for (Shortcut& shortcut : shortcuts) {
+                const EdgeId shortcut_id = edge_count + shortcuts_.size();
+                out_edges[shortcut.edge.from].push_back(shortcut_id);
+                in_edges[shortcut.edge.to].push_back(shortcut_id);
+                shortcuts_.push_back(shortcut);
+            }
+
+            is_contracted[vertex] = true;
+            ranks_[vertex] = next_rank++;
+            auto is_incident = [this, vertex](EdgeId edge_id) {
+                const auto& edge = GetAugmentedEdge(edge_id);
+                return edge.from == vertex || edge.to == vertex;
+            };
+            for (const EdgeId edge_id : in_edges[vertex]) {
+                const VertexId neighbour = GetAugmentedEdge(edge_id).from;
+                auto& neighbour_edges = out_edges[neighbour];
+                neighbour_edges.erase(std::remove_if(neighbour_edges.begin(), neighbour_edges.end(), is_incident),
+                                      neighbour_edges.end());
+                ++contracted_neighbours[neighbour];
+            }
+            for (const EdgeId edge_id : out_edges[vertex]) {
+                const VertexId neighbour = GetAugmentedEdge(edge_id).to;
+                auto& neighbour_edges = in_edges[neighbour];
+                neighbour_edges.erase(std::remove_if(neighbour_edges.begin(), neighbour_edges.end(), is_incident),
+                                      neighbour_edges.end());
+                ++contracted_neighbours[neighbour];
+            }
+            in_edges[vertex].clear();
+            out_edges[vertex].clear();
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraph() {
+        const size_t vertex_count = graph_->GetVertexCount();
+        const size_t edge_count = graph_->GetEdgeCount() + shortcuts_.size();
+        forward_offsets_.assign(vertex_count + 1, 0);
+        backward_offsets_.assign(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const auto& edge = GetAugmentedEdge(edge_id);
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                ++forward_offsets_[edge.from + 1];
+            } else if (ranks_[edge.from] > ranks_[edge.to]) {
+                ++backward_offsets_[edge.to + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            forward_offsets_[vertex + 1] += forward_offsets_[vertex];
+            backward_offsets_[vertex + 1] += backward_offsets_[vertex];
+        }
+        forward_edges_.resize(forward_offsets_.back());
+        backward_edges_.resize(backward_offsets_.back());
+        std::vector<size_t> forward_positions(forward_offsets_.begin(), forward_offsets_.end() - 1);
+        std::vector<size_t> backward_positions(backward_offsets_.begin(), backward_offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const auto& edge = GetAugmentedEdge(edge_id);
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                forward_edges_[forward_positions[edge.from]++] = edge_id;
+            } else if (ranks_[edge.from] > ranks_[edge.to]) {
+                backward_edges_[backward_positions[edge.to]++] = edge_id;
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+    ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_->GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ZERO_WEIGHT, {}};
+        }
+
+        thread_local SearchSpace forward_space;
+        thread_local SearchSpace backward_space;
+        forward_space.Reset(vertex_count);
+        backward_space.Reset(vertex_count);
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+        Queue forward_queue;
+        Queue backward_queue;
+        forward_space.Visit(from, ZERO_WEIGHT, NO_EDGE);
+        forward_queue.push({ZERO_WEIGHT, from});
+        backward_space.Visit(to, ZERO_WEIGHT, NO_EDGE);
+        backward_queue.push({ZERO_WEIGHT, to});
+
+        Weight best_weight = UNREACHABLE;
+        VertexId meeting_vertex = vertex_count;
+
+        auto step = [&](Queue& queue, SearchSpace& space, const SearchSpace& other_space, bool is_forward) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > space.weights[vertex]) {
+                return;
+            }
+            if (other_space.weights[vertex] != UNREACHABLE && weight + other_space.weights[vertex] < best_weight) {
+                best_weight = weight + other_space.weights[vertex];
+                meeting_vertex = vertex;
+            }
+            const auto& offsets = is_forward ? forward_offsets_ : backward_offsets_;
+            const auto& edges = is_forward ? forward_edges_ : backward_edges_;
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const auto& edge = GetAugmentedEdge(edges[i]);
+                const VertexId next = is_forward ? edge.to : edge.from;
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < space.weights[next]) {
+                    space.Visit(next, candidate_weight, edges[i]);
+                    queue.push({candidate_weight, next});
+                }
+            }
+        };
+
+        while (true) {
+            const bool forward_active = !forward_queue.empty() && forward_queue.top().first < best_weight;
+            const bool backward_active = !backward_queue.empty() && backward_queue.top().first < best_weight;
+            if (!forward_active && !backward_active) {
+                break;
+            }
+            if (forward_active && (!backward_active || forward_queue.top().first <= backward_queue.top().first)) {
+                step(forward_queue, forward_space, backward_space, true);
+            } else {
+                step(backward_queue, backward_space, forward_space, false);
+            }
+        }
+
+        if (meeting_vertex == vertex_count) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> upward_edges;
+        for (EdgeId edge_id = forward_space.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+             edge_id = forward_space.prev_edges[GetAugmentedEdge(edge_id).from]) {
+            upward_edges.push_back(edge_id);
+        }
+        std::reverse(upward_edges.begin(), upward_edges.end());
+        for (EdgeId edge_id = backward_space.prev_edges[meeting_vertex]; edge_id != NO_EDGE;
+             edge_id = backward_space.prev_edges[GetAugmentedEdge(edge_id).to]) {
+            upward_edges.push_back(edge_id);
+        }
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : upward_edges) {
+            UnpackEdge(edge_id, edges);
+        }
+        return RouteInfo{best_weight, std::move(edges)};
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> ContractionHierarchy<Weight>::GetRouteWeights(VertexId from,
+                                                                                     const std::vector<VertexId>& targets) const {
+        return ComputeRouteWeights(*graph_, from, targets);
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{edge_id};
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < graph_->GetEdgeCount()) {
+                edges.push_back(current);
+            } else {
+                const Shortcut& shortcut = shortcuts_[current - graph_->GetEdgeCount()];
+                stack.push_back(shortcut.second);
+                stack.push_back(shortcut.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    const std::vector<typename ContractionHierarchy<Weight>::Shortcut>& ContractionHierarchy<Weight>::GetShortcuts() const {
+        return shortcuts_;
+    }
+
+    template <typename Weight>
+    const std::vector<typename ContractionHierarchy<Weight>::Rank>& ContractionHierarchy<Weight>::GetRanks() const {
+        return ranks_;
+    }
+
+}  // namespace graph
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+
+namespace graph {
+
+    // Считает дерево кратчайших путей алгоритмом Дейкстры при первом обращении к вершине-источнику
+    // и держит последние использованные деревья в LRU-кэше, ограниченном по памяти.
+    template <typename Weight>
+    class DijkstraRouter : public RouterBase<Weight> {
+    private:
+        using GraphPtr = CompactGraphPtr<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+
+        static constexpr size_t DEFAULT_CACHE_SIZE = 64 * 1024 * 1024;
+
+        explicit DijkstraRouter(GraphPtr graph, size_t cacheSizeInBytes = DEFAULT_CACHE_SIZE);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+
+    private:
+        struct ShortestPathTree {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+        };
+        using ShortestPathTreePtr = std::shared_ptr<const ShortestPathTree>;
+
+        ShortestPathTreePtr GetShortestPathTree(VertexId from) const;
+        ShortestPathTreePtr ComputeShortestPathTree(VertexId from) const;
+
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr Weight ZERO_WEIGHT{};
+
+        GraphPtr graph_;
+        size_t cacheCapacity_;
+
+        mutable std::mutex cacheMutex_;
+        mutable std::list<VertexId> recentlyUsed_;
+        mutable std::unordered_map<VertexId, std::pair<ShortestPathTreePtr, std::list<VertexId>::iterator>> cache_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(GraphPtr graph, size_t cacheSizeInBytes)
+            : graph_(std::move(graph)) {
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            if (graph_->GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        const size_t treeSize = graph_->GetVertexCount() * (sizeof(Weight) + sizeof(EdgeId));
+        cacheCapacity_ = std::max<size_t>(1, treeSize == 0 ? 1 : cacheSizeInBytes / treeSize);
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                                 VertexId to) const {
+        if (from >= graph_->GetVertexCount() || to >= graph_->GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const ShortestPathTreePtr tree = GetShortestPathTree(from);
+        if (tree->weights[to] == UNREACHABLE) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = tree->prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = tree->prev_edges[graph_->GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{tree->weights[to], std::move(edges)};
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> DijkstraRouter<Weight>::GetRouteWeights(VertexId from,
+                                                                               const std::vector<VertexId>& targets) const {
+        if (from >= graph_->GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const ShortestPathTreePtr tree = GetShortestPathTree(from);
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(targets.size());
+        for (const VertexId to : targets) {
+            const Weight weight = tree->weights.at(to);
+            weights.push_back(weight == UNREACHABLE ? std::nullopt : std::optional<Weight>(weight));
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::ShortestPathTreePtr DijkstraRouter<Weight>::GetShortestPathTree(VertexId from) const {
+        {
+            std::lock_guard guard(cacheMutex_);
+            if (auto it = cache_.find(from); it != cache_.end()) {
+                recentlyUsed_.splice(recentlyUsed_.begin(), recentlyUsed_, it->second.second);
+                return it->second.first;
+            }
+        }
+
+        // Дерево считается без блокировки, чтобы запросы от разных источников не ждали друг друга
+        ShortestPathTreePtr tree = ComputeShortestPathTree(from);
+
+        std::lock_guard guard(cacheMutex_);
+        if (auto it = cache_.find(from); it != cache_.end()) {
+            return it->second.first;
+        }
+        while (cache_.size() >= cacheCapacity_) {
+            cache_.erase(recentlyUsed_.back());
+            recentlyUsed_.pop_back();
+        }
+        recentlyUsed_.push_front(from);
+        cache_.emplace(from, std::make_pair(tree, recentlyUsed_.begin()));
+        return tree;
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::ShortestPathTreePtr DijkstraRouter<Weight>::ComputeShortestPathTree(VertexId from) const {
+        const size_t vertex_count = graph_->GetVertexCount();
+        auto tree = std::make_shared<ShortestPathTree>();
+        tree->weights.assign(vertex_count, UNREACHABLE);
+        tree->prev_edges.assign(vertex_count, NO_EDGE);
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        tree->weights[from] = ZERO_WEIGHT;
+        queue.push({ZERO_WEIGHT, from});
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > tree->weights[vertex]) {
+                continue;
+            }
+            for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                const VertexId to = graph_->GetSlotTarget(slot);
+                const Weight candidate_weight = weight + graph_->GetSlotWeight(slot);
+                if (candidate_weight < tree->weights[to]) {
+                    tree->weights[to] = candidate_weight;
+                    tree->prev_edges[to] = graph_->GetSlotEdgeId(slot);
+                    queue.push({candidate_weight, to});
+                }
+            }
+        }
+        return tree;
+    }
+
+    // Веса путей из from до каждой вершины targets одним поиском Дейкстры, который останавливается,
+    // как только раскрыты все цели. Для движков без дерева или таблицы кратчайших путей.
+    template <typename Weight>
+    std::vector<std::optional<Weight>> ComputeRouteWeights(const CompactGraph<Weight>& graph, VertexId from,
+                                                           const std::vector<VertexId>& targets) {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (from >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        constexpr Weight unreachable = std::numeric_limits<Weight>::max();
+        std::vector<Weight> weights(vertex_count, unreachable);
+        std::vector<bool> is_target(vertex_count, false);
+        size_t remaining_targets = 0;
+        for (const VertexId to : targets) {
+            if (to >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (!is_target[to]) {
+                is_target[to] = true;
+                ++remaining_targets;
+            }
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        weights[from] = Weight{};
+        queue.push({Weight{}, from});
+        while (!queue.empty() && remaining_targets > 0) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) {
+                continue;
+            }
+            if (is_target[vertex]) {
+                is_target[vertex] = false;
+                --remaining_targets;
+            }
+            for (size_t slot = graph.GetFirstSlot(vertex); slot < graph.GetLastSlot(vertex); ++slot) {
+                const VertexId to = graph.GetSlotTarget(slot);
+                const Weight candidate_weight = weight + graph.GetSlotWeight(slot);
+                if (candidate_weight < weights[to]) {
+                    weights[to] = candidate_weight;
+                    queue.push({candidate_weight, to});
+                }
+            }
+        }
+
+        std::vector<std::optional<Weight>> route_weights;
+        route_weights.reserve(targets.size());
+        for (const VertexId to : targets) {
+            route_weights.push_back(weights[to] == unreachable ? std::nullopt : std::optional<Weight>(weights[to]));
+        }
+        return route_weights;
+    }
+
+    // Дейкстра из from, не раскрывающая вершины дальше budget: вершины, достижимые не дороже budget,
+    // с весами путей в порядке возрастания веса. Работа пропорциональна размеру достижимой области.
+    template <typename Weight>
+    std::vector<std::pair<VertexId, Weight>> ComputeReachableVertices(const CompactGraph<Weight>& graph, VertexId from,
+                                                                      Weight budget) {
+        if (from >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::unordered_map<VertexId, Weight> weights{{from, Weight{}}};
+        std::vector<std::pair<VertexId, Weight>> reachable;
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        queue.push({Weight{}, from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights.at(vertex)) {
+                continue;
+            }
+            reachable.emplace_back(vertex, weight);
+            for (size_t slot = graph.GetFirstSlot(vertex); slot < graph.GetLastSlot(vertex); ++slot) {
+                const VertexId to = graph.GetSlotTarget(slot);
+                const Weight candidate_weight = weight + graph.GetSlotWeight(slot);
+                if (candidate_weight > budget) {
+                    continue;
+                }
+                if (auto it = weights.find(to); it == weights.end() || candidate_weight < it->second) {
+                    weights[to] = candidate_weight;
+                    queue.push({candidate_weight, to});
+                }
+            }
+        }
+        return reachable;
+    }
+
+
+    // Дейкстра от from до to с весами рёбер edge_weight(edge_id) вместо хранящихся в графе.
+    // Ничего не предпосчитывает, поэтому годится для разовых запросов с другими весами.
+    template <typename Weight, typename EdgeWeightFunc>
+    std::optional<typename RouterBase<Weight>::RouteInfo> FindShortestPath(const CompactGraph<Weight>& graph, VertexId from,
+                                                                            VertexId to, EdgeWeightFunc edge_weight) {
+        if (from >= graph.GetVertexCount() || to >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::unordered_map<VertexId, std::pair<Weight, std::optional<EdgeId>>> labels{{from, {Weight{}, std::nullopt}}};
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        queue.push({Weight{}, from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > labels.at(vertex).first) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (size_t slot = graph.GetFirstSlot(vertex); slot < graph.GetLastSlot(vertex); ++slot) {
+                const VertexId next = graph.GetSlotTarget(slot);
+                const EdgeId edge_id = graph.GetSlotEdgeId(slot);
+                const Weight candidate_weight = weight + edge_weight(edge_id);
+                if (auto it = labels.find(next); it == labels.end() || candidate_weight < it->second.first) {
+                    labels[next] = {candidate_weight, edge_id};
+                    queue.push({candidate_weight, next});
+                }
+            }
+        }
+
+        const auto target = labels.find(to);
+        if (target == labels.end()) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (auto edge_id = target->second.second; edge_id; edge_id = labels.at(graph.GetEdge(*edge_id).from).second) {
+            edges.push_back(*edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return typename RouterBase<Weight>::RouteInfo{target->second.first, std::move(edges)};
+    }
+
+}  // namespace graph
@@ -1,5 +1,7 @@
 #include "domain.h"
 
+#include <algorithm>
+
 namespace transport_catalogue {
     Stop::Stop(const std::string& name, const geo::Coordinates& coordinates) :
             name_(name), coordinates_(coordinates){
@@ -9,11 +11,14 @@ namespace transport_catalogue {
         return name_ == stop.name_ && coordinates_ == stop.coordinates_;
     }
 
-    Bus::Bus(const std::string& name, const std::vector<const Stop*>& route, bool isRoundtrip) :
-            name_(name), route_(route), isRoundtrip_(isRoundtrip) {
+    Bus::Bus(const std::string& name, const std::vector<const Stop*>& route, bool isRoundtrip,
+             const std::vector<double>& departures) :
+            name_(name), route_(route), isRoundtrip_(isRoundtrip), departures_(departures) {
         for(auto stop : route_) {
-            uniqueStops.insert(reinterpret_cast<uintptr_t>(stop));
+            uniqueStops.push_back(stop->id_);
         }
+        std::sort(uniqueStops.begin(), uniqueStops.end());
+        uniqueStops.erase(std::unique(uniqueStops.begin(), uniqueStops.end()), uniqueStops.end());
     }
 
     bool Bus::operator==(const Bus& bus) const {
@@ -37,7 +42,8 @@ namespace transport_catalogue {
               distance_to_stops_(move(distance_to_stops)){
     }
 
-    BusQuery::BusQuery(const std::string &name, const std::vector<std::string>& stopNames, bool isRoundtrip)
-            : name_(name), stopNames_(stopNames), isRoundtrip_(isRoundtrip) {
+    BusQuery::BusQuery(const std::string &name, const std::vector<std::string>& stopNames, bool isRoundtrip,
+                       const std::vector<double>& departures)
+            : name_(name), stopNames_(stopNames), isRoundtrip_(isRoundtrip), departures_(departures) {
     }
 }
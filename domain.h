@@ -1,7 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <unordered_set>
 
 #include "geo.h"
 
@@ -10,24 +10,32 @@ namespace transport_catalogue{
     struct Stop {
         std::string name_;
         geo::Coordinates coordinates_;
+        // Номер остановки в порядке добавления в справочник, назначается в TransportCatalogue::AddStop
+        uint32_t id_ = 0;
 
         Stop() = default;
         Stop(const std::string& name, const geo::Coordinates& coordinates);
         bool operator==(const Stop& stop) const;
-        operator uintptr_t() const {
-            uintptr_t a = reinterpret_cast<uintptr_t>(this);
-            return a;
-        }
     };
 
     struct Bus {
         std::string name_;
         std::vector<const Stop*> route_;
-        std::unordered_set <uintptr_t, std::hash<uintptr_t>> uniqueStops;
+        // Номера остановок маршрута без повторов по возрастанию
+        std::vector<uint32_t> uniqueStops;
         bool isRoundtrip_;
+        // Номер автобуса в порядке добавления в справочник, назначается в TransportCatalogue::AddBus
+        uint32_t id_ = 0;
+        // Время отправления рейсов с первой остановки маршрута в минутах от начала суток.
+        // Время не заворачивается через полночь: рейсы после полуночи задаются как 1440 и больше
+        std::vector<double> departures_;
+        // Расстояние по дорогам и по прямой от первой остановки маршрута до i-й, заполняет TransportCatalogue
+        std::vector<double> routeDistances_;
+        std::vector<double> geoDistances_;
 
         Bus() = default;
-        Bus(const std::string& name, const std::vector<const Stop*>& route, bool isRoundtrip);
+        Bus(const std::string& name, const std::vector<const Stop*>& route, bool isRoundtrip,
+            const std::vector<double>& departures = {});
         bool operator==(const Bus& bus) const;
     };
 
@@ -43,6 +51,14 @@ namespace transport_catalogue{
         bool operator==(const BusInfo& busInfo) const;
     };
 
+    // Готовый ответ на запрос Bus: считается один раз при построении базы и хранится в ней
+    struct BusStat {
+        uint32_t stopCount = 0;
+        uint32_t uniqueStopCount = 0;
+        double routeLength = 0.;
+        double curvature = 0.;
+    };
+
     struct StopQuery {
         StopQuery(const std::string& name, double latitude, double longitude,
                   const std::vector<std::pair<std::string, int>>& distance_to_stops);
@@ -53,9 +69,11 @@ namespace transport_catalogue{
     };
 
     struct BusQuery {
-        BusQuery(const std::string &name, const std::vector<std::string>& stopNames, bool isRingRoute);
+        BusQuery(const std::string &name, const std::vector<std::string>& stopNames, bool isRingRoute,
+                 const std::vector<double>& departures = {});
         std::string name_;
         std::vector<std::string> stopNames_;
         bool isRoundtrip_;
+        std::vector<double> departures_;
     };
 }
@@ -0,0 +1,90 @@
+#include "flat_distance_table.h"
+#include "hash_mix.h"
+
+#include <algorithm>
+
+namespace transport_catalogue {
+
+    FlatDistanceTable::FlatDistanceTable(const std::vector<Entry>& entries) {
+        Reserve(entries.size());
+        for (const Entry& entry : entries) {
+            Set(entry.from, entry.to, entry.distance);
+        }
+    }
+
+    void FlatDistanceTable::Reserve(size_t count) {
+        // Заполнение не выше половины держит цепочки проб короткими и гарантирует пустую ячейку
+        size_t capacity = MIN_CAPACITY;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        if (capacity > keys_.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    void FlatDistanceTable::Set(uint32_t from, uint32_t to, int distance) {
+        if ((size_ + 1) * 2 > keys_.size()) {
+            Rehash(std::max(MIN_CAPACITY, keys_.size() * 2));
+        }
+        Insert(PackKey(from, to), distance);
+    }
+
+    std::optional<int> FlatDistanceTable::Find(uint32_t from, uint32_t to) const {
+        if (keys_.empty()) {
+            return std::nullopt;
+        }
+        const uint64_t key = PackKey(from, to);
+        const uint64_t reverseKey = PackKey(to, from);
+        const size_t mask = keys_.size() - 1;
+        std::optional<int> reverseDistance;
+        for (size_t slot = GetHomeSlot(from, to); keys_[slot] != EMPTY_KEY; slot = (slot + 1) & mask) {
+            if (keys_[slot] == key) {
+                return distances_[slot];
+            }
+            if (keys_[slot] == reverseKey) {
+                reverseDistance = distances_[slot];
+            }
+        }
+        return reverseDistance;
+    }
+
+    size_t FlatDistanceTable::Size() const {
+        return size_;
+    }
+
+    uint64_t FlatDistanceTable::PackKey(uint32_t from, uint32_t to) {
+        return static_cast<uint64_t>(from) << 32 | to;
+    }
+
+    size_t FlatDistanceTable::GetHomeSlot(uint32_t from, uint32_t to) const {
+        return MixHash(PackKey(std::min(from, to), std::max(from, to))) & (keys_.size() - 1);
+    }
+
+    void FlatDistanceTable::Rehash(size_t capacity) {
+        std::vector<uint64_t> oldKeys(capacity, EMPTY_KEY);
+        std::vector<int> oldDistances(capacity);
+        keys_.swap(oldKeys);
+        distances_.swap(oldDistances);
+        size_ = 0;
+        for (size_t slot = 0; slot < oldKeys.size(); ++slot) {
+            if (oldKeys[slot] != EMPTY_KEY) {
+                Insert(oldKeys[slot], oldDistances[slot]);
+            }
+        }
+    }
+
+    void FlatDistanceTable::Insert(uint64_t key, int distance) {
+        const size_t mask = keys_.size() - 1;
+        size_t slot = GetHomeSlot(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+        while (keys_[slot] != EMPTY_KEY && keys_[slot] != key) {
+            slot = (slot + 1) & mask;
+        }
+        if (keys_[slot] == EMPTY_KEY) {
+            keys_[slot] = key;
+            ++size_;
+        }
+        distances_[slot] = distance;
+    }
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // Расстояния по дорогам между остановками в открытой адресации с линейным пробированием.
+    // Ключ - пара номеров (from, to), упакованная в 64 бита. Домашняя ячейка считается по неупорядоченной паре,
+    // поэтому прямое и обратное расстояние лежат на одной цепочке проб и находятся за один проход.
+    class FlatDistanceTable {
+    public:
+        struct Entry {
+            uint32_t from;
+            uint32_t to;
+            int distance;
+        };
+
+        FlatDistanceTable() = default;
+        // Ёмкость выбирается сразу под все записи, поэтому построение из базы обходится без перехеширования
+        explicit FlatDistanceTable(const std::vector<Entry>& entries);
+
+        void Reserve(size_t count);
+        // Добавляет расстояние from -> to или заменяет уже заданное
+        void Set(uint32_t from, uint32_t to, int distance);
+        // Расстояние from -> to, а если его нет - to -> from
+        [[nodiscard]] std::optional<int> Find(uint32_t from, uint32_t to) const;
+        [[nodiscard]] size_t Size() const;
+
+        template <typename Func>
+        void ForEach(Func func) const;
+
+    private:
+        static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        static uint64_t PackKey(uint32_t from, uint32_t to);
+        [[nodiscard]] size_t GetHomeSlot(uint32_t from, uint32_t to) const;
+        void Rehash(size_t capacity);
+        void Insert(uint64_t key, int distance);
+
+        std::vector<uint64_t> keys_;
+        std::vector<int> distances_;
+        size_t size_ = 0;
+    };
+
+    template <typename Func>
+    void FlatDistanceTable::ForEach(Func func) const {
+        for (size_t slot = 0; slot < keys_.size(); ++slot) {
+            if (keys_[slot] != EMPTY_KEY) {
+                func(Entry{static_cast<uint32_t>(keys_[slot] >> 32), static_cast<uint32_t>(keys_[slot]),
+                           distances_[slot]});
+            }
+        }
+    }
+
+}
@@ -3,6 +3,30 @@
 
 namespace geo {
 
+    namespace {
+        const double DEGREES_TO_RADIANS = M_PI / 180.;
+        const double EARTH_RADIUS = 6371000;
+
+        double ComputeExactDistance(double latFrom, double lngFrom, double sinFrom, double cosFrom,
+                                    double latTo, double lngTo, double sinTo, double cosTo) {
+            using namespace std;
+            const bool isSamePoint = latFrom == latTo && lngFrom == lngTo;
+            const double distance = acos(sinFrom * sinTo + cosFrom * cosTo * cos(abs(lngFrom - lngTo) * DEGREES_TO_RADIANS))
+                                    * EARTH_RADIUS;
+            return isSamePoint ? 0. : distance;
+        }
+
+        double ComputeFastDistance(double latFrom, double lngFrom, double cosFrom,
+                                   double latTo, double lngTo, double cosTo) {
+            // Разница долгот через антимеридиан приводится в [-180, 180]
+            double lngDelta = lngTo - lngFrom;
+            lngDelta -= 360. * std::round(lngDelta / 360.);
+            const double x = lngDelta * DEGREES_TO_RADIANS * (cosFrom + cosTo) / 2;
+            const double y = (latTo - latFrom) * DEGREES_TO_RADIANS;
+            return std::sqrt(x * x + y * y) * EARTH_RADIUS;
+        }
+    }
+
     double ComputeDistance(Coordinates from, Coordinates to) {
         using namespace std;
         if (from == to) {
@@ -14,4 +38,51 @@ namespace geo {
                * 6371000;
     }
 
-}  // namespace geo
\ No newline at end of file
+    void CoordinatesTable::Add(Coordinates coordinates) {
+        lat.push_back(coordinates.lat);
+        lng.push_back(coordinates.lng);
+        sinLat.push_back(std::sin(coordinates.lat * DEGREES_TO_RADIANS));
+        cosLat.push_back(std::cos(coordinates.lat * DEGREES_TO_RADIANS));
+    }
+
+    size_t CoordinatesTable::Size() const {
+        return lat.size();
+    }
+
+    double ComputeDistance(const CoordinatesTable& table, uint32_t from, uint32_t to, DistanceMode mode) {
+        if (mode == DistanceMode::Fast) {
+            return ComputeFastDistance(table.lat[from], table.lng[from], table.cosLat[from],
+                                       table.lat[to], table.lng[to], table.cosLat[to]);
+        }
+        return ComputeExactDistance(table.lat[from], table.lng[from], table.sinLat[from], table.cosLat[from],
+                                    table.lat[to], table.lng[to], table.sinLat[to], table.cosLat[to]);
+    }
+
+    void ComputeHopDistances(const CoordinatesTable& table, const std::vector<uint32_t>& path,
+                             std::vector<double>& distances, DistanceMode mode) {
+        const size_t pointCount = path.size();
+        distances.assign(pointCount < 2 ? 0 : pointCount - 1, 0.);
+        std::vector<double> lat(pointCount);
+        std::vector<double> lng(pointCount);
+        std::vector<double> sinLat(pointCount);
+        std::vector<double> cosLat(pointCount);
+        for (size_t i = 0; i < pointCount; ++i) {
+            lat[i] = table.lat[path[i]];
+            lng[i] = table.lng[path[i]];
+            sinLat[i] = table.sinLat[path[i]];
+            cosLat[i] = table.cosLat[path[i]];
+        }
+
+        if (mode == DistanceMode::Fast) {
+            for (size_t i = 0; i < distances.size(); ++i) {
+                distances[i] = ComputeFastDistance(lat[i], lng[i], cosLat[i], lat[i + 1], lng[i + 1], cosLat[i + 1]);
+            }
+            return;
+        }
+        for (size_t i = 0; i < distances.size(); ++i) {
+            distances[i] = ComputeExactDistance(lat[i], lng[i], sinLat[i], cosLat[i],
+                                                lat[i + 1], lng[i + 1], sinLat[i + 1], cosLat[i + 1]);
+        }
+    }
+
+}  // namespace geo
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+namespace transport_catalogue {
+
+    // Финальное перемешивание из MurmurHash3: близкие значения расходятся по всем битам.
+    // Не зависит от реализации стандартной библиотеки, поэтому годится для таблиц, хранимых в базе
+    inline uint64_t MixHash(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+}
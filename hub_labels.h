@@ -0,0 +1,348 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    // Двухшаговая разметка (hub labelling): у каждой вершины есть прямая метка - хабы, достижимые из неё,
+    // и обратная - хабы, из которых достижима она. Метки отсортированы по рангу хаба, поэтому
+    // запрос - это слияние прямой метки начала с обратной меткой конца. Строится разметка
+    // алгоритмом pruned landmark labelling в порядке убывания степени вершин.
+    template <typename Weight>
+    class HubLabels : public RouterBase<Weight> {
+    private:
+        using GraphPtr = CompactGraphPtr<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+        using EdgeIndex = uint32_t;
+        static constexpr EdgeIndex NO_EDGE = std::numeric_limits<EdgeIndex>::max();
+
+        // edge - первое ребро пути от вершины к хабу в прямой метке и последнее ребро пути от хаба в обратной
+        struct LabelEntry {
+            uint32_t hub;
+            EdgeIndex edge;
+            Weight weight;
+        };
+
+        struct Labels {
+            std::vector<size_t> offsets;
+            std::vector<LabelEntry> entries;
+        };
+
+        struct LabelStatistics {
+            size_t total_entries;
+            double average_forward_size;
+            double average_backward_size;
+            size_t max_forward_size;
+            size_t max_backward_size;
+        };
+
+        explicit HubLabels(GraphPtr graph);
+        HubLabels(GraphPtr graph, Labels forward_labels, Labels backward_labels);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+
+        const Labels& GetForwardLabels() const;
+        const Labels& GetBackwardLabels() const;
+        LabelStatistics GetStatistics() const;
+
+    private:
+        using LabelLists = std::vector<std::vector<LabelEntry>>;
+
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeIndex> prev_edges;
+            std::vector<VertexId> touched;
+            // Веса до хабов из метки текущей вершины-хаба, индекс - ранг хаба
+            std::vector<Weight> hub_weights;
+
+            explicit SearchSpace(size_t vertex_count);
+            void Reset();
+            void Visit(VertexId vertex, Weight weight, EdgeIndex prev_edge);
+        };
+
+        void BuildLabels();
+        void RunPrunedSearch(VertexId hub_vertex, uint32_t hub, bool is_forward,
+                             LabelLists& own_labels, const LabelLists& other_labels, SearchSpace& space,
+                             const std::vector<std::vector<EdgeId>>& in_edges) const;
+        static Labels Flatten(LabelLists lists);
+        static const LabelEntry* FindEntry(const Labels& labels, VertexId vertex, uint32_t hub);
+        // Слияние прямой метки from с обратной меткой to: вес кратчайшего пути и хаб, через который он проходит
+        std::pair<Weight, uint32_t> FindBestHub(VertexId from, VertexId to) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+
+        GraphPtr graph_;
+        Labels forward_labels_;
+        Labels backward_labels_;
+    };
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(GraphPtr graph)
+            : graph_(std::move(graph)) {
+        if (graph_->GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for hub labels");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            if (graph_->GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        BuildLabels();
+    }
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(GraphPtr graph, Labels forward_labels, Labels backward_labels)
+            : graph_(std::move(graph)), forward_labels_(std::move(forward_labels)), backward_labels_(std::move(backward_labels)) {
+        const size_t offsets_size = graph_->GetVertexCount() + 1;
+        if (forward_labels_.offsets.size() != offsets_size || backward_labels_.offsets.size() != offsets_size
+            || forward_labels_.offsets.back() != forward_labels_.entries.size()
+            || backward_labels_.offsets.back() != backward_labels_.entries.size()) {
+            throw std::invalid_argument("Hub labels don't match the graph");
+        }
+    }
+
+    template <typename Weight>
+    HubLabels<Weight>::SearchSpace::SearchSpace(size_t vertex_count)
+            : weights(vertex_count, UNREACHABLE), prev_edges(vertex_count, NO_EDGE),
+              hub_weights(vertex_count, UNREACHABLE) {
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::SearchSpace::Reset() {
+        for (const VertexId vertex : touched) {
+            weights[vertex] = UNREACHABLE;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::SearchSpace::Visit(VertexId vertex, Weight weight, EdgeIndex prev_edge) {
+        if (weights[vertex] == UNREACHABLE) {
+            touched.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::BuildLabels() {
+        const size_t vertex_count = graph_->GetVertexCount();
+        std::vector<std::vector<EdgeId>> in_edges(vertex_count);
+        std::vector<size_t> degrees(vertex_count, 0);
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_->GetEdge(edge_id);
+            in_edges[edge.to].push_back(edge_id);
+            ++degrees[edge.from];
+            ++degrees[edge.to];
+        }
+        std::vector<VertexId> order(vertex_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&degrees](VertexId lhs, VertexId rhs) {
+            return degrees[lhs] > degrees[rhs];
+        });
+
+        LabelLists forward_lists(vertex_count);
+        LabelLists backward_lists(vertex_count);
+        SearchSpace space(vertex_count);
+        for (uint32_t hub = 0; hub < vertex_count; ++hub) {
+            const VertexId hub_vertex = order[hub];
+            RunPrunedSearch(hub_vertex, hub, true, backward_lists, forward_lists, space, in_edges);
+            RunPrunedSearch(hub_vertex, hub, false, forward_lists, backward_lists, space, in_edges);
+        }
+        forward_labels_ = Flatten(std::move(forward_lists));
+        backward_labels_ = Flatten(std::move(backward_lists));
+    }
+
+    // Прямой поиск от хаба дополняет обратные метки достигнутых вершин, обратный - прямые.
+    // Вершина отсекается, если уже построенные метки дают путь не длиннее найденного.
+    template <typename Weight>
+    void HubLabels<Weight>::RunPrunedSearch(VertexId hub_vertex, uint32_t hub, bool is_forward,
+                                            LabelLists& own_labels, const LabelLists& other_labels,
+                                            SearchSpace& space,
+                                            const std::vector<std::vector<EdgeId>>& in_edges) const {
+        for (const LabelEntry& entry : other_labels[hub_vertex]) {
+            space.hub_weights[entry.hub] = entry.weight;
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        space.Visit(hub_vertex, ZERO_WEIGHT, NO_EDGE);
+        queue.push({ZERO_WEIGHT, hub_vertex});
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > space.weights[vertex]) {
+                continue;
+            }
+            bool is_covered = false;
+            for (const LabelEntry& entry : own_labels[vertex]) {
+                if (space.hub_weights[entry.hub] != UNREACHABLE
+                    && space.hub_weights[entry.hub] + entry.weight <= weight) {
+                    is_covered = true;
+                    break;
+                }
+            }
+            if (is_covered) {
+                continue;
+            }
+            own_labels[vertex].push_back({hub, space.prev_edges[vertex], weight});
+
+            auto relax = [&](EdgeId edge_id, VertexId next, Weight edge_weight) {
+                const Weight candidate_weight = weight + edge_weight;
+                if (candidate_weight < space.weights[next]) {
+                    space.Visit(next, candidate_weight, static_cast<EdgeIndex>(edge_id));
+                    queue.push({candidate_weight, next});
+                }
+            };
+            if (is_forward) {
+                for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                    relax(graph_->GetSlotEdgeId(slot), graph_->GetSlotTarget(slot), graph_->GetSlotWeight(slot));
+                }
+            } else {
+                for (const EdgeId edge_id : in_edges[vertex]) {
+                    const auto edge = graph_->GetEdge(edge_id);
+                    relax(edge_id, edge.from, edge.weight);
+                }
+            }
+        }
+
+        space.Reset();
+        for (const LabelEntry& entry : other_labels[hub_vertex]) {
+            space.hub_weights[entry.hub] = UNREACHABLE;
+        }
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::Labels HubLabels<Weight>::Flatten(LabelLists lists) {
+        Labels labels;
+        labels.offsets.reserve(lists.size() + 1);
+        labels.offsets.push_back(0);
+        for (auto& list : lists) {
+            labels.entries.insert(labels.entries.end(), list.begin(), list.end());
+            labels.offsets.push_back(labels.entries.size());
+            list = {};
+        }
+        return labels;
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::LabelEntry* HubLabels<Weight>::FindEntry(const Labels& labels, VertexId vertex,
+                                                                               uint32_t hub) {
+        const LabelEntry* begin = labels.entries.data() + labels.offsets[vertex];
+        const LabelEntry* end = labels.entries.data() + labels.offsets[vertex + 1];
+        const LabelEntry* it = std::lower_bound(begin, end, hub, [](const LabelEntry& entry, uint32_t value) {
+            return entry.hub < value;
+        });
+        if (it == end || it->hub != hub) {
+            throw std::logic_error("Hub labels are inconsistent");
+        }
+        return it;
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+        const auto [best_weight, best_hub] = FindBestHub(from, to);
+        if (best_weight == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeIndex edge_id = FindEntry(forward_labels_, from, best_hub)->edge; edge_id != NO_EDGE;
+             edge_id = FindEntry(forward_labels_, graph_->GetEdge(edge_id).to, best_hub)->edge) {
+            edges.push_back(edge_id);
+        }
+        const size_t forward_size = edges.size();
+        for (EdgeIndex edge_id = FindEntry(backward_labels_, to, best_hub)->edge; edge_id != NO_EDGE;
+             edge_id = FindEntry(backward_labels_, graph_->GetEdge(edge_id).from, best_hub)->edge) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin() + forward_size, edges.end());
+
+        return RouteInfo{best_weight, std::move(edges)};
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> HubLabels<Weight>::GetRouteWeights(VertexId from,
+                                                                          const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(targets.size());
+        for (const VertexId to : targets) {
+            const Weight weight = FindBestHub(from, to).first;
+            weights.push_back(weight == UNREACHABLE ? std::nullopt : std::optional<Weight>(weight));
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    std::pair<Weight, uint32_t> HubLabels<Weight>::FindBestHub(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_->GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+
+        const LabelEntry* forward = forward_labels_.entries.data() + forward_labels_.offsets[from];
+        const LabelEntry* forward_end = forward_labels_.entries.data() + forward_labels_.offsets[from + 1];
+        const LabelEntry* backward = backward_labels_.entries.data() + backward_labels_.offsets[to];
+        const LabelEntry* backward_end = backward_labels_.entries.data() + backward_labels_.offsets[to + 1];
+        Weight best_weight = UNREACHABLE;
+        uint32_t best_hub = 0;
+        while (forward != forward_end && backward != backward_end) {
+            if (forward->hub < backward->hub) {
+                ++forward;
+            } else if (backward->hub < forward->hub) {
+                ++backward;
+            } else {
+                if (forward->weight + backward->weight < best_weight) {
+                    best_weight = forward->weight + backward->weight;
+                    best_hub = forward->hub;
+                }
+                ++forward;
+                ++backward;
+            }
+        }
+        return {best_weight, best_hub};
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::Labels& HubLabels<Weight>::GetForwardLabels() const {
+        return forward_labels_;
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::Labels& HubLabels<Weight>::GetBackwardLabels() const {
+        return backward_labels_;
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::LabelStatistics HubLabels<Weight>::GetStatistics() const {
+        const size_t vertex_count = graph_->GetVertexCount();
+        LabelStatistics statistics{forward_labels_.entries.size() + backward_labels_.entries.size(), 0., 0., 0, 0};
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            statistics.max_forward_size = std::max(statistics.max_forward_size,
+                                                   forward_labels_.offsets[vertex + 1] - forward_labels_.offsets[vertex]);
+            statistics.max_backward_size = std::max(statistics.max_backward_size,
+                                                    backward_labels_.offsets[vertex + 1] - backward_labels_.offsets[vertex]);
+        }
+        if (vertex_count > 0) {
+            statistics.average_forward_size = static_cast<double>(forward_labels_.entries.size()) / vertex_count;
+            statistics.average_backward_size = static_cast<double>(backward_labels_.entries.size()) / vertex_count;
+        }
+        return statistics;
+    }
+
+}  // namespace graph
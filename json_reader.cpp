@@ -3,8 +3,18 @@
 
 
 TransportCatalogue JsonReader::BuildCatalogueBase(const Document& doc){
+    using namespace std::literals;
     TransportCatalogue catalogue;
+    const auto& root = doc.GetRoot().AsDict();
+    if(root.count("catalogue_settings"s)) {
+        const auto& catalogueSettings = root.at("catalogue_settings"s).AsDict();
+        if(catalogueSettings.count("geo_distance_mode"s)) {
+            catalogue.SetGeoDistanceMode(GetGeoDistanceMode(catalogueSettings.at("geo_distance_mode"s).AsString()));
+        }
+    }
     LoadBaseRequests(catalogue, doc);
+    catalogue.BuildStatTables();
+    catalogue.BuildNameIndices();
     return catalogue;
 }
 
@@ -28,7 +38,14 @@ void JsonReader::LoadBaseRequests(TransportCatalogue& outCatalogue, const Docume
                     busStops.push_back(busStops[i]);
                 }
             }
-            buses.push_back({busNode.at("name"s).AsString(), busStops, isRingRoute});
+            std::vector<double> departures;
+            if(busNode.count("departures"s)) {
+                for(auto& departureNode : busNode.at("departures"s).AsArray()) {
+                    departures.push_back(departureNode.AsDouble());
+                }
+                std::sort(departures.begin(), departures.end());
+            }
+            buses.push_back({busNode.at("name"s).AsString(), busStops, isRingRoute, departures});
         } else {
             assert(elem.AsDict().at("type"s) == "Stop"s || elem.AsDict().at("type"s) == "Bus"s);
         }
@@ -40,8 +57,92 @@ RoutingSetting JsonReader::LoadRoutingSettings(const Document& doc) {
     using namespace std::literals;
     auto& node = doc.GetRoot();
     auto& routingSettings = node.AsDict().at("routing_settings"s).AsDict();
-    return {routingSettings.at("bus_wait_time"s).AsDouble(),
-            routingSettings.at("bus_velocity"s).AsDouble()};
+    RoutingSetting routingSetting{routingSettings.at("bus_wait_time"s).AsDouble(),
+                                  routingSettings.at("bus_velocity"s).AsDouble()};
+    if(routingSettings.count("router"s)) {
+        routingSetting.routerType = GetRouterType(routingSettings.at("router"s).AsString());
+    }
+    if(routingSettings.count("dijkstra_cache_mb"s)) {
+        routingSetting.dijkstraCacheSize = static_cast<size_t>(routingSettings.at("dijkstra_cache_mb"s).AsInt()) * 1024 * 1024;
+    }
+    if(routingSettings.count("cell_size"s)) {
+        routingSetting.cellSize = static_cast<size_t>(routingSettings.at("cell_size"s).AsInt());
+    }
+    if(routingSettings.count("graph_model"s)) {
+        routingSetting.graphModel = GetGraphModel(routingSettings.at("graph_model"s).AsString());
+    }
+    if(routingSettings.count("route_cache_size"s)) {
+        routingSetting.routeCacheSize = static_cast<size_t>(routingSettings.at("route_cache_size"s).AsInt());
+    }
+    return routingSetting;
+}
+
+transport_router::RouterType JsonReader::GetRouterType(const std::string& name) {
+    using namespace std::literals;
+    using transport_router::RouterType;
+    if(name == "floyd_warshall"s) {
+        return RouterType::FloydWarshall;
+    } else if(name == "dijkstra"s) {
+        return RouterType::Dijkstra;
+    } else if(name == "contraction_hierarchy"s) {
+        return RouterType::ContractionHierarchy;
+    } else if(name == "hub_labels"s) {
+        return RouterType::HubLabels;
+    } else if(name == "partition_overlay"s) {
+        return RouterType::PartitionOverlay;
+    } else if(name == "raptor"s) {
+        return RouterType::Raptor;
+    }
+    throw std::invalid_argument("Unknown router type: "s + name);
+}
+
+transport_router::GraphModel JsonReader::GetGraphModel(const std::string& name) {
+    using namespace std::literals;
+    using transport_router::GraphModel;
+    if(name == "complete"s) {
+        return GraphModel::Complete;
+    } else if(name == "linear"s) {
+        return GraphModel::Linear;
+    }
+    throw std::invalid_argument("Unknown graph model: "s + name);
+}
+
+geo::DistanceMode JsonReader::GetGeoDistanceMode(const std::string& name) {
+    using namespace std::literals;
+    if(name == "exact"s) {
+        return geo::DistanceMode::Exact;
+    } else if(name == "fast"s) {
+        return geo::DistanceMode::Fast;
+    }
+    throw std::invalid_argument("Unknown geo distance mode: "s + name);
+}
+
+
+void JsonReader::UpdateStopsDistances(TransportCatalogue& catalogue, const Document& doc) {
+    using namespace std::literals;
+    auto& baseRequests = doc.GetRoot().AsDict().at("base_requests"s).AsArray();
+    // Обновить можно только расстояния между уже известными остановками
+    for(auto& elem : baseRequests) {
+        auto& stopNode = elem.AsDict();
+        const std::string& name = stopNode.at("name"s).AsString();
+        if(stopNode.at("type"s).AsString() != "Stop"s) {
+            throw std::invalid_argument("Only Stop requests can update the base: "s + name);
+        }
+        if(!stopNode.count("road_distances"s)) {
+            throw std::invalid_argument("No road_distances for stop "s + name);
+        }
+        const Stop* stopFrom = catalogue.FindStop(name);
+        if(!stopFrom) {
+            throw std::invalid_argument("Unknown stop: "s + name);
+        }
+        for(const auto& [stopName, distance] : GetDistanceToStops(stopNode.at("road_distances"s))) {
+            const Stop* stopTo = catalogue.FindStop(stopName);
+            if(!stopTo) {
+                throw std::invalid_argument("Unknown stop: "s + stopName);
+            }
+            catalogue.SetStopsDistance(stopFrom, stopTo, distance);
+        }
+    }
 }
 
 
@@ -126,14 +227,6 @@ void JsonReader::LoadDataInCatalogue(TransportCatalogue& catalogue,
         catalogue.AddStop({stop.name_, {stop.latitude_, stop.longitude_}});
     }
 
-    for(auto bus : buses) {
-        std::vector<const Stop*> route;
-        for(std::string& stopName : bus.stopNames_) {
-            route.push_back(&catalogue.GetStop(stopName));
-        }
-        catalogue.AddBus({bus.name_, route, bus.isRoundtrip_});
-    }
-
     for(auto stopFrom : stops) {
         const Stop* stopFromInCatalogue = &catalogue.GetStop(stopFrom.name_);
         for(auto &[stopTo, distance] : stopFrom.distance_to_stops_) {
@@ -141,4 +234,13 @@ void JsonReader::LoadDataInCatalogue(TransportCatalogue& catalogue,
             catalogue.SetStopsDistance(stopFromInCatalogue, stopToInCatalogue, distance);
         }
     }
+
+    // Автобусы после расстояний: длины маршрутов считаются один раз при добавлении
+    for(auto bus : buses) {
+        std::vector<const Stop*> route;
+        for(std::string& stopName : bus.stopNames_) {
+            route.push_back(&catalogue.GetStop(stopName));
+        }
+        catalogue.AddBus({bus.name_, route, bus.isRoundtrip_, bus.departures_});
+    }
 }
\ No newline at end of file
@@ -25,11 +25,17 @@ public:
     RenderSettings GetMapRenderSettings(const Document& doc);
     RoutingSetting LoadRoutingSettings(const Document& doc);
     SerializationSetting LoadSerializationSettings(const Document& doc);
+    // Новые расстояния между остановками из base_requests (Stop с name и road_distances) для update_base.
+    // Другие запросы и неизвестные остановки - std::invalid_argument
+    void UpdateStopsDistances(TransportCatalogue& catalogue, const Document& doc);
 
 private:
     void LoadBaseRequests(TransportCatalogue& OutCatalogue, const Document& doc);
 
 
+    transport_router::RouterType GetRouterType(const std::string& name);
+    transport_router::GraphModel GetGraphModel(const std::string& name);
+    geo::DistanceMode GetGeoDistanceMode(const std::string& name);
     svg::Color GetColorFromNode(const Node& node);
     std::vector<svg::Color> GetArrayColorFromNode(const Node& node);
     StopsDistancesArray  GetDistanceToStops(const Node& nodeWithStopNamesAndDistance);
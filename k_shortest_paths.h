@@ -0,0 +1,236 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // k кратчайших путей без циклов алгоритмом Йена. Первый путь берётся у движка маршрутизации,
+    // каждый следующий - лучший из путей-ответвлений от уже найденных: корень совпадает с префиксом
+    // предыдущего пути, а ответвление ищется Дейкстрой без рёбер, которыми уже выходили из той же вершины
+    // с тем же корнем, и без вершин корня. Поиски ответвлений независимы и идут параллельно.
+    template <typename Weight>
+    class KShortestPaths {
+    private:
+        using GraphPtr = CompactGraphPtr<Weight>;
+
+    public:
+        using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+        // Решает, выдавать ли путь; вызывается по разу на каждый найденный путь в порядке возрастания веса
+        using PathFilter = std::function<bool(const RouteInfo&)>;
+
+        // Сколько путей извлекается на один выданный, если accept отклоняет пути
+        static constexpr size_t MAX_EXTRACTED_PER_PATH = 16;
+
+        explicit KShortestPaths(GraphPtr graph);
+
+        // Не больше count путей по возрастанию веса. Без accept кандидатов хранится не больше, чем путей осталось найти.
+        // Путь, отклонённый accept, не выдаётся и не засчитывается, но от него ищутся ответвления. С accept кандидаты
+        // не отбрасываются: заранее неизвестно, сколько из них он отклонит, а отброшенный кандидат мог оказаться
+        // следующим выданным путём. Всего путей извлекается не больше count * MAX_EXTRACTED_PER_PATH.
+        std::vector<RouteInfo> FindPaths(const RouterBase<Weight>& router, VertexId from, VertexId to, size_t count,
+                                         size_t thread_count = 1, const PathFilter& accept = nullptr) const;
+
+    private:
+        // Рабочие массивы поиска переиспользуются между ответвлениями, сбрасываются только затронутые вершины
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<VertexId> touched;
+            std::vector<bool> is_blocked;
+            std::vector<VertexId> blocked;
+
+            void Reset(size_t vertex_count);
+            void Visit(VertexId vertex, Weight weight, EdgeId prev_edge);
+            void Block(VertexId vertex);
+        };
+
+        std::optional<RouteInfo> FindSpurPath(const std::vector<RouteInfo>& paths, const RouteInfo& previous,
+                                              size_t spur_index, VertexId to) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        GraphPtr graph_;
+    };
+
+    template <typename Weight>
+    void KShortestPaths<Weight>::SearchSpace::Reset(size_t vertex_count) {
+        if (weights.size() != vertex_count) {
+            weights.assign(vertex_count, UNREACHABLE);
+            prev_edges.assign(vertex_count, NO_EDGE);
+            is_blocked.assign(vertex_count, false);
+            touched.clear();
+            blocked.clear();
+            return;
+        }
+        for (const VertexId vertex : touched) {
+            weights[vertex] = UNREACHABLE;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        for (const VertexId vertex : blocked) {
+            is_blocked[vertex] = false;
+        }
+        touched.clear();
+        blocked.clear();
+    }
+
+    template <typename Weight>
+    void KShortestPaths<Weight>::SearchSpace::Visit(VertexId vertex, Weight weight, EdgeId prev_edge) {
+        if (weights[vertex] == UNREACHABLE) {
+            touched.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+    }
+
+    template <typename Weight>
+    void KShortestPaths<Weight>::SearchSpace::Block(VertexId vertex) {
+        if (!is_blocked[vertex]) {
+            is_blocked[vertex] = true;
+            blocked.push_back(vertex);
+        }
+    }
+
+    template <typename Weight>
+    KShortestPaths<Weight>::KShortestPaths(GraphPtr graph)
+            : graph_(std::move(graph)) {
+    }
+
+    template <typename Weight>
+    std::vector<typename KShortestPaths<Weight>::RouteInfo>
+    KShortestPaths<Weight>::FindPaths(const RouterBase<Weight>& router, VertexId from, VertexId to, size_t count,
+                                      size_t thread_count, const PathFilter& accept) const {
+        std::vector<RouteInfo> accepted_paths;
+        if (count == 0) {
+            return accepted_paths;
+        }
+        auto shortest = router.BuildRoute(from, to);
+        if (!shortest) {
+            return accepted_paths;
+        }
+        // Все извлечённые пути, включая отклонённые accept: от каждого ищутся ответвления
+        std::vector<RouteInfo> paths;
+        auto take_path = [&](RouteInfo path) {
+            paths.push_back(std::move(path));
+            if (!accept || accept(paths.back())) {
+                accepted_paths.push_back(paths.back());
+            }
+        };
+        take_path(std::move(*shortest));
+        const size_t max_paths = count * MAX_EXTRACTED_PER_PATH;
+
+        // Кандидаты упорядочены по весу, одинаковые пути из разных ответвлений склеиваются
+        auto by_weight = [](const RouteInfo& lhs, const RouteInfo& rhs) {
+            return std::tie(lhs.weight, lhs.edges) < std::tie(rhs.weight, rhs.edges);
+        };
+        std::set<RouteInfo, decltype(by_weight)> candidates(by_weight);
+        std::vector<std::optional<RouteInfo>> spur_paths;
+        while (accepted_paths.size() < count && paths.size() < max_paths) {
+            const RouteInfo& previous = paths.back();
+            spur_paths.assign(previous.edges.size(), std::nullopt);
+            parallel::ParallelFor(previous.edges.size(), thread_count, [&](size_t spur_index) {
+                spur_paths[spur_index] = FindSpurPath(paths, previous, spur_index, to);
+            }, 1);
+
+            for (auto& spur_path : spur_paths) {
+                if (spur_path) {
+                    candidates.insert(std::move(*spur_path));
+                }
+            }
+            // Без accept каждый извлечённый кандидат выдаётся, и кандидаты хуже, чем нужно для оставшихся путей,
+            // уже не понадобятся. С accept любой из лучших кандидатов может быть отклонён, поэтому хранятся все
+            if (!accept) {
+                const size_t needed = count - accepted_paths.size();
+                while (candidates.size() > needed) {
+                    candidates.erase(std::prev(candidates.end()));
+                }
+            }
+            if (candidates.empty()) {
+                break;
+            }
+            take_path(std::move(candidates.extract(candidates.begin()).value()));
+        }
+        return accepted_paths;
+    }
+
+    template <typename Weight>
+    std::optional<typename KShortestPaths<Weight>::RouteInfo>
+    KShortestPaths<Weight>::FindSpurPath(const std::vector<RouteInfo>& paths, const RouteInfo& previous,
+                                         size_t spur_index, VertexId to) const {
+        thread_local SearchSpace space;
+        space.Reset(graph_->GetVertexCount());
+
+        // Вершины корня, кроме вершины ответвления, запрещены, чтобы путь остался без циклов
+        const auto root_begin = previous.edges.begin();
+        const auto root_end = previous.edges.begin() + spur_index;
+        Weight root_weight = ZERO_WEIGHT;
+        for (auto it = root_begin; it != root_end; ++it) {
+            const Edge<Weight> edge = graph_->GetEdge(*it);
+            space.Block(edge.from);
+            root_weight += edge.weight;
+        }
+        const VertexId spur_vertex = graph_->GetEdge(previous.edges[spur_index]).from;
+
+        // Запрещены рёбра, которыми найденные пути с тем же корнем уходят из вершины ответвления
+        std::vector<EdgeId> blocked_edges;
+        for (const RouteInfo& path : paths) {
+            if (path.edges.size() > spur_index && std::equal(root_begin, root_end, path.edges.begin())) {
+                blocked_edges.push_back(path.edges[spur_index]);
+            }
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        space.Visit(spur_vertex, ZERO_WEIGHT, NO_EDGE);
+        queue.push({ZERO_WEIGHT, spur_vertex});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > space.weights[vertex]) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                const VertexId next = graph_->GetSlotTarget(slot);
+                if (space.is_blocked[next]) {
+                    continue;
+                }
+                if (vertex == spur_vertex && std::find(blocked_edges.begin(), blocked_edges.end(),
+                                                       graph_->GetSlotEdgeId(slot)) != blocked_edges.end()) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + graph_->GetSlotWeight(slot);
+                if (candidate_weight < space.weights[next]) {
+                    space.Visit(next, candidate_weight, graph_->GetSlotEdgeId(slot));
+                    queue.push({candidate_weight, next});
+                }
+            }
+        }
+        if (space.weights[to] == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges(root_begin, root_end);
+        const size_t root_size = edges.size();
+        for (EdgeId edge_id = space.prev_edges[to]; edge_id != NO_EDGE; edge_id = space.prev_edges[graph_->GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin() + root_size, edges.end());
+        return RouteInfo{root_weight + space.weights[to], std::move(edges)};
+    }
+
+}  // namespace graph
@@ -4,11 +4,14 @@
 #include "router.h"
 #include "transport_router.h"
 #include "serialization.h"
+#include "parallel.h"
+
+#include <cstdio>
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests|test] [--threads N] [--cache-stats]\n"sv;
 }
 
 void PrintGraph(transport_router::Graph graph) {
@@ -27,13 +30,70 @@ void PrintGraph(transport_router::Graph graph) {
 }
 
 
+// Старая база может быть отображена в память работающим process_requests, поэтому новая пишется рядом
+// и подменяет её переименованием
+bool WriteBase(const std::string& filename, const TransportCatalogue& catalogue, const MapRenderer& mapRenderer,
+               const TransportRouter& router) {
+    const std::string tmpFilename = filename + ".tmp"s;
+    std::ofstream output(tmpFilename, std::ios::binary);
+    serialization::Serialize(output, catalogue, mapRenderer, router);
+    output.flush();
+    output.close();
+    // Недописанная база (например, при переполнении диска) не должна заменить прежнюю
+    if (!output) {
+        std::cerr << "Can't write "sv << tmpFilename << '\n';
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Can't replace "sv << filename << '\n';
+        return false;
+    }
+    return true;
+}
+
+struct Options {
+    size_t threadCount = parallel::GetDefaultThreadCount();
+    // Печатать счётчики кэша маршрутов в std::clog после process_requests
+    bool printCacheStatistics = false;
+};
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 2; i < argc; ++i) {
+        if (argv[i] == "--cache-stats"sv) {
+            options.printCacheStatistics = true;
+            continue;
+        }
+        if (argv[i] != "--threads"sv || i + 1 == argc) {
+            return std::nullopt;
+        }
+        try {
+            const int value = std::stoi(argv[++i]);
+            if (value <= 0) {
+                return std::nullopt;
+            }
+            options.threadCount = static_cast<size_t>(value);
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
+    const std::optional<Options> options = ParseOptions(argc, argv);
+    if (!options) {
+        PrintUsage();
+        return 1;
+    }
+    const size_t threadCount = options->threadCount;
 
     if (mode == "make_base"sv) {
         JsonReader jsonReader;
@@ -42,12 +102,34 @@ int main(int argc, char* argv[]) {
         SerializationSetting serializationSetting = jsonReader.LoadSerializationSettings(doc);
         MapRenderer mapRenderer(jsonReader.GetMapRenderSettings(doc));
         RoutingSetting routingSetting = jsonReader.LoadRoutingSettings(doc);
-        TransportRouter router(catalogue, routingSetting);
-        {
-            std::ofstream output(serializationSetting.filename, std::ios::binary);
-            serialization::Serialize(output, catalogue, mapRenderer, router);
+        TransportRouter router(catalogue, routingSetting, threadCount);
+        if (const auto statistics = router.GetHubLabelStatistics()) {
+            std::clog << "Hub labels: "sv << statistics->total_entries << " entries, forward label avg "sv
+                      << statistics->average_forward_size << " max "sv << statistics->max_forward_size
+                      << ", backward label avg "sv << statistics->average_backward_size
+                      << " max "sv << statistics->max_backward_size << std::endl;
+        }
+        if (!WriteBase(serializationSetting.filename, catalogue, mapRenderer, router)) {
+            return 1;
         }
 
+    } else if (mode == "update_base"sv) {
+        JsonReader jsonReader;
+        json::Document doc = json::Load(std::cin);
+        SerializationSetting serializationSetting = jsonReader.LoadSerializationSettings(doc);
+
+        TransportCatalogue catalogue;
+        MapRenderer mapRenderer;
+        TransportRouter transportRouter;
+        serialization::Deserialize(serializationSetting.filename, catalogue, mapRenderer, transportRouter);
+        jsonReader.UpdateStopsDistances(catalogue, doc);
+        if (const auto recomputedRowCount = transportRouter.UpdateEdgeWeights(threadCount)) {
+            std::clog << "Route table: "sv << *recomputedRowCount << " of "sv
+                      << transportRouter.GetGraph().GetVertexCount() << " rows recomputed"sv << std::endl;
+        }
+        if (!WriteBase(serializationSetting.filename, catalogue, mapRenderer, transportRouter)) {
+            return 1;
+        }
 
     } else if (mode == "process_requests"sv) {
         JsonReader jsonReader;
@@ -57,13 +139,24 @@ int main(int argc, char* argv[]) {
         TransportCatalogue catalogue;
         MapRenderer mapRenderer;
         TransportRouter transportRouter;
-        {
-            std::ifstream input(serializationSetting.filename, std::ios::binary);
-            serialization::Deserialize(input, catalogue, mapRenderer, transportRouter);
-        }
-        RequestHandler requestHandler(catalogue, mapRenderer, transportRouter);
+        serialization::Deserialize(serializationSetting.filename, catalogue, mapRenderer, transportRouter);
+        RequestHandler requestHandler(catalogue, mapRenderer, transportRouter, threadCount);
         json::Document result = requestHandler.ExecuteQuery(doc);
         Print(result, std::cout);
+        if (options->printCacheStatistics) {
+            const auto statistics = transportRouter.GetRouteCacheStatistics();
+            std::clog << "Route cache: "sv << statistics.hits << " hits, "sv << statistics.misses << " misses, "sv
+                      << statistics.size << " routes"sv << std::endl;
+        }
+
+    } else if (mode == "test"sv) {
+        TransportCatalogue catalogue;
+        transport_catalogue::tests::GettingBusInfo(catalogue);
+        transport_router::tests::AlternativeRoutesAreDistinct();
+        transport_router::tests::EnginesMatchFloydWarshall();
+        transport_router::tests::UpdatedWeightsMatchRebuild();
+        transport_router::tests::RouteCacheEvictsLeastRecentlyUsed();
+        std::cout << "All tests passed\n"sv;
 
     } else {
         PrintUsage();
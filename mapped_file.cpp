@@ -0,0 +1,49 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace serialization {
+
+    MappedFile::MappedFile(const std::string& filename) {
+        using namespace std::literals;
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if(fd == -1) {
+            throw std::runtime_error("Can't open file "s + filename);
+        }
+        struct stat fileStat{};
+        if(fstat(fd, &fileStat) == -1) {
+            close(fd);
+            throw std::runtime_error("Can't stat file "s + filename);
+        }
+        size_ = static_cast<size_t>(fileStat.st_size);
+        if(size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if(data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Can't map file "s + filename);
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if(data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* MappedFile::GetData() const {
+        return data_;
+    }
+
+    size_t MappedFile::GetSize() const {
+        return size_;
+    }
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace serialization {
+
+    // Отображение файла в память только для чтения; страницы разделяются между процессами
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& filename);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        [[nodiscard]] const char* GetData() const;
+        [[nodiscard]] size_t GetSize() const;
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    inline size_t GetDefaultThreadCount() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Вызывает func(index) для каждого index из [0, count), раздавая индексы потокам порциями по chunkSize.
+    // Первое исключение из func останавливает раздачу порций и пробрасывается после завершения всех потоков
+    template <typename Func>
+    void ParallelFor(size_t count, size_t threadCount, Func func, size_t chunkSize = 16) {
+        threadCount = std::max<size_t>(1, std::min(threadCount, (count + chunkSize - 1) / chunkSize));
+        if(threadCount == 1) {
+            for(size_t index = 0; index < count; ++index) {
+                func(index);
+            }
+            return;
+        }
+
+        std::atomic<size_t> nextChunk{0};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto stop = [&]() {
+            std::lock_guard guard(errorMutex);
+            if(!error) {
+                error = std::current_exception();
+            }
+            nextChunk.store(count);
+        };
+        auto worker = [&]() {
+            try {
+                for(size_t begin = nextChunk.fetch_add(chunkSize); begin < count; begin = nextChunk.fetch_add(chunkSize)) {
+                    const size_t end = std::min(count, begin + chunkSize);
+                    for(size_t index = begin; index < end; ++index) {
+                        func(index);
+                    }
+                }
+            } catch(...) {
+                stop();
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        try {
+            for(size_t i = 0; i + 1 < threadCount; ++i) {
+                threads.emplace_back(worker);
+            }
+        } catch(...) {
+            // Поток не создался - уже запущенные дорабатывают свои порции и выходят
+            stop();
+        }
+        worker();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+#include "router.h"
+#include "dijkstra_router.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace graph {
+
+    // Маршрутизатор на разбиении графа на ячейки (в духе CRP). Для каждой ячейки заранее считаются
+    // кратчайшие пути внутри неё от входных граничных вершин до выходных (клика ячейки). Запрос -
+    // поиск Дейкстры по ячейкам начала и конца маршрута и по оверлею из клик и рёбер между ячейками.
+    // Рёбра клики при восстановлении пути разворачиваются поиском внутри ячейки.
+    template <typename Weight>
+    class PartitionOverlay : public RouterBase<Weight> {
+    private:
+        using GraphPtr = CompactGraphPtr<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+        using CellId = uint32_t;
+
+        PartitionOverlay(GraphPtr graph, std::vector<CellId> cells, size_t thread_count = 1);
+        PartitionOverlay(GraphPtr graph, std::vector<CellId> cells, std::vector<Weight> clique_weights);
+        // Оверлей previous для graph - того же графа с другими весами рёбер. Пересчитываются
+        // только клики ячеек, внутри которых изменился вес хотя бы одного ребра.
+        PartitionOverlay(GraphPtr graph, const PartitionOverlay& previous, size_t thread_count = 1);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        // Один поиск Дейкстры по исходному графу вместо запроса с разворачиванием клик до каждой цели
+        std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+
+        // Пересчитывает клику ячейки по текущим весам рёбер
+        void RebuildCell(CellId cell);
+
+        const std::vector<CellId>& GetCells() const;
+        const std::vector<Weight>& GetCliqueWeights() const;
+        size_t GetCellCount() const;
+
+    private:
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<VertexId> prev_vertices;
+            std::vector<VertexId> touched;
+
+            void Reset(size_t vertex_count);
+            void Visit(VertexId vertex, Weight weight, EdgeId prev_edge, VertexId prev_vertex);
+        };
+
+        void BuildBoundaries();
+        void ComputeCellSearch(VertexId from, SearchSpace& space) const;
+        void AppendCellPath(VertexId from, VertexId to, std::vector<EdgeId>& edges) const;
+        size_t GetEntryCount(CellId cell) const;
+        size_t GetExitCount(CellId cell) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+        GraphPtr graph_;
+        std::vector<CellId> cells_;
+
+        // Входные вершины ячейки - те, в которые ведут рёбра из других ячеек, выходные - из которых рёбра ведут наружу
+        std::vector<size_t> entry_offsets_;
+        std::vector<VertexId> entries_;
+        std::vector<size_t> exit_offsets_;
+        std::vector<VertexId> exits_;
+        std::vector<size_t> entry_indices_;
+        std::vector<size_t> exit_indices_;
+
+        // Клика ячейки - матрица весов входы x выходы, хранится построчно начиная с clique_offsets_[cell]
+        std::vector<size_t> clique_offsets_;
+        std::vector<Weight> clique_weights_;
+    };
+
+    template <typename Weight>
+    void PartitionOverlay<Weight>::SearchSpace::Reset(size_t vertex_count) {
+        if (weights.size() != vertex_count) {
+            weights.assign(vertex_count, UNREACHABLE);
+            prev_edges.assign(vertex_count, NO_EDGE);
+            prev_vertices.assign(vertex_count, 0);
+            touched.clear();
+            return;
+        }
+        for (const VertexId vertex : touched) {
+            weights[vertex] = UNREACHABLE;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+    }
+
+    template <typename Weight>
+    void PartitionOverlay<Weight>::SearchSpace::Visit(VertexId vertex, Weight weight, EdgeId prev_edge,
+                                                      VertexId prev_vertex) {
+        if (weights[vertex] == UNREACHABLE) {
+            touched.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+        prev_vertices[vertex] = prev_vertex;
+    }
+
+    template <typename Weight>
+    PartitionOverlay<Weight>::PartitionOverlay(GraphPtr graph, std::vector<CellId> cells, size_t thread_count)
+            : graph_(std::move(graph)), cells_(std::move(cells)) {
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            if (graph_->GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        BuildBoundaries();
+        clique_weights_.assign(clique_offsets_.back(), UNREACHABLE);
+        parallel::ParallelFor(GetCellCount(), thread_count, [this](size_t cell) {
+            RebuildCell(static_cast<CellId>(cell));
+        }, 1);
+    }
+
+    template <typename Weight>
+    PartitionOverlay<Weight>::PartitionOverlay(GraphPtr graph, std::vector<CellId> cells,
+                                               std::vector<Weight> clique_weights)
+            : graph_(std::move(graph)), cells_(std::move(cells)), clique_weights_(std::move(clique_weights)) {
+        BuildBoundaries();
+        if (clique_weights_.size() != clique_offsets_.back()) {
+            throw std::invalid_argument("Overlay doesn't match the partition");
+        }
+    }
+
+    template <typename Weight>
+    PartitionOverlay<Weight>::PartitionOverlay(GraphPtr graph, const PartitionOverlay& previous, size_t thread_count)
+            : graph_(std::move(graph)), cells_(previous.cells_), clique_weights_(previous.clique_weights_) {
+        if (graph_->GetEdgeCount() != previous.graph_->GetEdgeCount()) {
+            throw std::invalid_argument("Overlay doesn't match the graph");
+        }
+        BuildBoundaries();
+        std::vector<bool> is_stale(GetCellCount(), false);
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            const Edge<Weight> edge = graph_->GetEdge(edge_id);
+            const Edge<Weight> previous_edge = previous.graph_->GetEdge(edge_id);
+            if (edge.from != previous_edge.from || edge.to != previous_edge.to) {
+                throw std::invalid_argument("Overlay doesn't match the graph");
+            }
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            // Рёбра между ячейками в клики не входят
+            if (edge.weight != previous_edge.weight && cells_[edge.from] == cells_[edge.to]) {
+                is_stale[cells_[edge.from]] = true;
+            }
+        }
+        std::vector<CellId> stale_cells;
+        for (CellId cell = 0; cell < is_stale.size(); ++cell) {
+            if (is_stale[cell]) {
+                stale_cells.push_back(cell);
+            }
+        }
+        parallel::ParallelFor(stale_cells.size(), thread_count, [&](size_t index) {
+            RebuildCell(stale_cells[index]);
+        }, 1);
+    }
+
+    template <typename Weight>
+    void PartitionOverlay<Weight>::BuildBoundaries() {
+        const size_t vertex_count = graph_->GetVertexCount();
+        if (cells_.size() != vertex_count) {
+            throw std::invalid_argument("Partition doesn't match the graph");
+        }
+        const size_t cell_count = cells_.empty() ? 0 : *std::max_element(cells_.begin(), cells_.end()) + 1;
+
+        std::vector<bool> is_entry(vertex_count, false);
+        std::vector<bool> is_exit(vertex_count, false);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                const VertexId to = graph_->GetSlotTarget(slot);
+                if (cells_[vertex] != cells_[to]) {
+                    is_exit[vertex] = true;
+                    is_entry[to] = true;
+                }
+            }
+        }
+
+        entry_offsets_.assign(cell_count + 1, 0);
+        exit_offsets_.assign(cell_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            entry_offsets_[cells_[vertex] + 1] += is_entry[vertex];
+            exit_offsets_[cells_[vertex] + 1] += is_exit[vertex];
+        }
+        for (size_t cell = 0; cell < cell_count; ++cell) {
+            entry_offsets_[cell + 1] += entry_offsets_[cell];
+            exit_offsets_[cell + 1] += exit_offsets_[cell];
+        }
+
+        entries_.assign(entry_offsets_.back(), 0);
+        exits_.assign(exit_offsets_.back(), 0);
+        entry_indices_.assign(vertex_count, NO_INDEX);
+        exit_indices_.assign(vertex_count, NO_INDEX);
+        std::vector<size_t> entry_counts(cell_count, 0);
+        std::vector<size_t> exit_counts(cell_count, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            const CellId cell = cells_[vertex];
+            if (is_entry[vertex]) {
+                entry_indices_[vertex] = entry_counts[cell]++;
+                entries_[entry_offsets_[cell] + entry_indices_[vertex]] = vertex;
+            }
+            if (is_exit[vertex]) {
+                exit_indices_[vertex] = exit_counts[cell]++;
+                exits_[exit_offsets_[cell] + exit_indices_[vertex]] = vertex;
+            }
+        }
+
+        clique_offsets_.assign(cell_count + 1, 0);
+        for (CellId cell = 0; cell < cell_count; ++cell) {
+            clique_offsets_[cell + 1] = clique_offsets_[cell] + GetEntryCount(cell) * GetExitCount(cell);
+        }
+    }
+
+    template <typename Weight>
+    void PartitionOverlay<Weight>::RebuildCell(CellId cell) {
+        if (cell >= GetCellCount()) {
+            throw std::out_of_range("Cell id is out of range");
+        }
+        thread_local SearchSpace space;
+        const size_t exit_count = GetExitCount(cell);
+        for (size_t entry = 0; entry < GetEntryCount(cell); ++entry) {
+            space.Reset(graph_->GetVertexCount());
+            ComputeCellSearch(entries_[entry_offsets_[cell] + entry], space);
+            Weight* row = clique_weights_.data() + clique_offsets_[cell] + entry * exit_count;
+            for (size_t exit = 0; exit < exit_count; ++exit) {
+                row[exit] = space.weights[exits_[exit_offsets_[cell] + exit]];
+            }
+        }
+    }
+
+    // Дейкстра по рёбрам внутри ячейки вершины from
+    template <typename Weight>
+    void PartitionOverlay<Weight>::ComputeCellSearch(VertexId from, SearchSpace& space) const {
+        const CellId cell = cells_[from];
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        space.Visit(from, ZERO_WEIGHT, NO_EDGE, from);
+        queue.push({ZERO_WEIGHT, from});
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > space.weights[vertex]) {
+                continue;
+            }
+            for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                const VertexId to = graph_->GetSlotTarget(slot);
+                if (cells_[to] != cell) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + graph_->GetSlotWeight(slot);
+                if (candidate_weight < space.weights[to]) {
+                    space.Visit(to, candidate_weight, graph_->GetSlotEdgeId(slot), vertex);
+                    queue.push({candidate_weight, to});
+                }
+            }
+        }
+    }
+
+    template <typename Weight>
+    void PartitionOverlay<Weight>::AppendCellPath(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+        thread_local SearchSpace space;
+        space.Reset(graph_->GetVertexCount());
+        ComputeCellSearch(from, space);
+        const size_t path_begin = edges.size();
+        for (EdgeId edge_id = space.prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = space.prev_edges[graph_->GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin() + path_begin, edges.end());
+    }
+
+    template <typename Weight>
+    std::optional<typename PartitionOverlay<Weight>::RouteInfo> PartitionOverlay<Weight>::BuildRoute(VertexId from,
+                                                                                                     VertexId to) const {
+        const size_t vertex_count = graph_->GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const CellId from_cell = cells_[from];
+        const CellId to_cell = cells_[to];
+
+        // Переход по клике помечается отсутствием ребра: prev_vertices хранит входную вершину ячейки
+        thread_local SearchSpace space;
+        space.Reset(vertex_count);
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        space.Visit(from, ZERO_WEIGHT, NO_EDGE, from);
+        queue.push({ZERO_WEIGHT, from});
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > space.weights[vertex]) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            const CellId cell = cells_[vertex];
+            const bool is_local = cell == from_cell || cell == to_cell;
+            for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                const VertexId next = graph_->GetSlotTarget(slot);
+                if (!is_local && cells_[next] == cell) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + graph_->GetSlotWeight(slot);
+                if (candidate_weight < space.weights[next]) {
+                    space.Visit(next, candidate_weight, graph_->GetSlotEdgeId(slot), vertex);
+                    queue.push({candidate_weight, next});
+                }
+            }
+            if (!is_local && entry_indices_[vertex] != NO_INDEX) {
+                const size_t exit_count = GetExitCount(cell);
+                const Weight* row = clique_weights_.data() + clique_offsets_[cell] + entry_indices_[vertex] * exit_count;
+                for (size_t exit = 0; exit < exit_count; ++exit) {
+                    if (row[exit] == UNREACHABLE) {
+                        continue;
+                    }
+                    const VertexId exit_vertex = exits_[exit_offsets_[cell] + exit];
+                    const Weight candidate_weight = weight + row[exit];
+                    if (candidate_weight < space.weights[exit_vertex]) {
+                        space.Visit(exit_vertex, candidate_weight, NO_EDGE, vertex);
+                        queue.push({candidate_weight, exit_vertex});
+                    }
+                }
+            }
+        }
+
+        if (space.weights[to] == UNREACHABLE) {
+            return std::nullopt;
+        }
+
+        // Сначала собираем переходы от конца к началу, затем разворачиваем клики по порядку
+        std::vector<std::pair<VertexId, EdgeId>> steps;
+        for (VertexId vertex = to; vertex != from; vertex = space.prev_vertices[vertex]) {
+            steps.push_back({vertex, space.prev_edges[vertex]});
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+            const auto [vertex, edge_id] = *it;
+            if (edge_id != NO_EDGE) {
+                edges.push_back(edge_id);
+            } else {
+                AppendCellPath(space.prev_vertices[vertex], vertex, edges);
+            }
+        }
+
+        return RouteInfo{space.weights[to], std::move(edges)};
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> PartitionOverlay<Weight>::GetRouteWeights(VertexId from,
+                                                                                 const std::vector<VertexId>& targets) const {
+        return ComputeRouteWeights(*graph_, from, targets);
+    }
+
+    template <typename Weight>
+    const std::vector<typename PartitionOverlay<Weight>::CellId>& PartitionOverlay<Weight>::GetCells() const {
+        return cells_;
+    }
+
+    template <typename Weight>
+    const std::vector<Weight>& PartitionOverlay<Weight>::GetCliqueWeights() const {
+        return clique_weights_;
+    }
+
+    template <typename Weight>
+    size_t PartitionOverlay<Weight>::GetCellCount() const {
+        return clique_offsets_.size() - 1;
+    }
+
+    template <typename Weight>
+    size_t PartitionOverlay<Weight>::GetEntryCount(CellId cell) const {
+        return entry_offsets_[cell + 1] - entry_offsets_[cell];
+    }
+
+    template <typename Weight>
+    size_t PartitionOverlay<Weight>::GetExitCount(CellId cell) const {
+        return exit_offsets_[cell + 1] - exit_offsets_[cell];
+    }
+
+}  // namespace graph
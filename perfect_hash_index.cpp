@@ -0,0 +1,122 @@
+#include "perfect_hash_index.h"
+#include "hash_mix.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace transport_catalogue {
+
+    namespace {
+        const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+        const uint64_t FNV_PRIME = 0x100000001b3ULL;
+        const uint64_t GOLDEN_RATIO = 0x9e3779b97f4a7c15ULL;
+    }
+
+    PerfectHashIndex::PerfectHashIndex(const std::vector<std::string_view>& names) {
+        const size_t nameCount = names.size();
+        if (nameCount == 0) {
+            return;
+        }
+        // Одинаковые имена попадают в одну ячейку при любом смещении, поэтому проверяются заранее
+        std::vector<std::string_view> sortedNames(names);
+        std::sort(sortedNames.begin(), sortedNames.end());
+        if (const auto it = std::adjacent_find(sortedNames.begin(), sortedNames.end()); it != sortedNames.end()) {
+            throw std::invalid_argument("Can't build perfect hash index: duplicate name " + std::string(*it));
+        }
+        displacements_.assign((nameCount + NAMES_PER_BUCKET - 1) / NAMES_PER_BUCKET, 0);
+        ids_.assign(nameCount, 0);
+
+        std::vector<uint64_t> hashes(nameCount);
+        std::vector<std::vector<uint32_t>> buckets(displacements_.size());
+        for (uint32_t id = 0; id < nameCount; ++id) {
+            hashes[id] = HashName(names[id]);
+            buckets[GetBucket(hashes[id])].push_back(id);
+        }
+        // Большие корзины размещаются первыми, пока свободных ячеек много
+        std::vector<size_t> bucketOrder(buckets.size());
+        std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+        std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&buckets](size_t lhs, size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        std::vector<bool> isSlotTaken(nameCount, false);
+        std::vector<size_t> slots;
+        for (const size_t bucket : bucketOrder) {
+            const auto& bucketIds = buckets[bucket];
+            if (bucketIds.empty()) {
+                break;
+            }
+            uint32_t displacement = 0;
+            for (;; ++displacement) {
+                if (displacement == MAX_DISPLACEMENT) {
+                    throw std::invalid_argument("Can't build perfect hash index: no displacement places a bucket of "
+                                                + std::to_string(bucketIds.size()) + " names");
+                }
+                slots.clear();
+                bool isPlaced = true;
+                for (const uint32_t id : bucketIds) {
+                    const size_t slot = GetSlot(hashes[id], displacement, nameCount);
+                    if (isSlotTaken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        isPlaced = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (isPlaced) {
+                    break;
+                }
+            }
+            displacements_[bucket] = displacement;
+            for (size_t i = 0; i < bucketIds.size(); ++i) {
+                isSlotTaken[slots[i]] = true;
+                ids_[slots[i]] = bucketIds[i];
+            }
+        }
+    }
+
+    PerfectHashIndex::PerfectHashIndex(std::vector<uint32_t> displacements, std::vector<uint32_t> ids)
+            : displacements_(std::move(displacements)), ids_(std::move(ids)) {
+        if (ids_.empty() != displacements_.empty()) {
+            throw std::invalid_argument("Perfect hash index is inconsistent");
+        }
+    }
+
+    std::optional<uint32_t> PerfectHashIndex::FindCandidate(std::string_view name) const {
+        if (ids_.empty()) {
+            return std::nullopt;
+        }
+        const uint64_t hash = HashName(name);
+        return ids_[GetSlot(hash, displacements_[GetBucket(hash)], ids_.size())];
+    }
+
+    size_t PerfectHashIndex::Size() const {
+        return ids_.size();
+    }
+
+    const std::vector<uint32_t>& PerfectHashIndex::GetDisplacements() const {
+        return displacements_;
+    }
+
+    const std::vector<uint32_t>& PerfectHashIndex::GetIds() const {
+        return ids_;
+    }
+
+    uint64_t PerfectHashIndex::HashName(std::string_view name) {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        for (const char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+        }
+        return MixHash(hash);
+    }
+
+    size_t PerfectHashIndex::GetSlot(uint64_t hash, uint32_t displacement, size_t slotCount) {
+        return MixHash(hash + displacement * GOLDEN_RATIO) % slotCount;
+    }
+
+    size_t PerfectHashIndex::GetBucket(uint64_t hash) const {
+        return (hash >> 32) % displacements_.size();
+    }
+
+}
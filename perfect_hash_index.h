@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // Минимальная совершенная хеш-функция над набором имён по схеме hash and displace:
+    // имя хешируется один раз, старшие биты выбирают корзину, смещение корзины вместе с хешем - ячейку.
+    // Хеш не зависит от реализации стандартной библиотеки, поэтому индекс можно хранить в базе.
+    class PerfectHashIndex {
+    public:
+        PerfectHashIndex() = default;
+        // i-е имя получает номер i; при повторяющихся именах или неудачном поиске смещения - std::invalid_argument
+        explicit PerfectHashIndex(const std::vector<std::string_view>& names);
+        PerfectHashIndex(std::vector<uint32_t> displacements, std::vector<uint32_t> ids);
+
+        // Номер имени из набора. Для имени не из набора возвращается произвольный номер, его нужно сверить с именем
+        [[nodiscard]] std::optional<uint32_t> FindCandidate(std::string_view name) const;
+        [[nodiscard]] size_t Size() const;
+
+        [[nodiscard]] const std::vector<uint32_t>& GetDisplacements() const;
+        [[nodiscard]] const std::vector<uint32_t>& GetIds() const;
+
+    private:
+        static constexpr size_t NAMES_PER_BUCKET = 4;
+        static constexpr uint32_t MAX_DISPLACEMENT = 1u << 24;
+
+        static uint64_t HashName(std::string_view name);
+        static size_t GetSlot(uint64_t hash, uint32_t displacement, size_t slotCount);
+        [[nodiscard]] size_t GetBucket(uint64_t hash) const;
+
+        std::vector<uint32_t> displacements_;
+        // Номер имени по ячейке
+        std::vector<uint32_t> ids_;
+    };
+
+}
@@ -0,0 +1,175 @@
+#include "raptor_router.h"
+
+namespace transport_router {
+
+    RaptorRouter::RaptorRouter(const TransportCatalogue& db, double busWaitTime, double busVelocity)
+        : defaultSetting_{busWaitTime, busVelocity}, stopCount_(db.GetAllStops().size()) {
+
+        routeOffsets_.push_back(0);
+        std::vector<size_t> stopRouteCounts(stopCount_ + 1, 0);
+        for(const auto& bus : db.GetBuses()) {
+            for(size_t i = 0; i < bus.route_.size(); ++i) {
+                const uint32_t stopIndex = bus.route_[i]->id_;
+                routeStops_.push_back(stopIndex);
+                routeDistances_.push_back(bus.routeDistances_[i]);
+                ++stopRouteCounts[stopIndex + 1];
+            }
+            routeOffsets_.push_back(routeStops_.size());
+        }
+
+        for(size_t i = 0; i < stopCount_; ++i) {
+            stopRouteCounts[i + 1] += stopRouteCounts[i];
+        }
+        stopRouteOffsets_ = stopRouteCounts;
+        stopRoutes_.resize(routeStops_.size());
+        for(uint32_t route = 0; route + 1 < routeOffsets_.size(); ++route) {
+            for(size_t i = routeOffsets_[route]; i < routeOffsets_[route + 1]; ++i) {
+                stopRoutes_[stopRouteCounts[routeStops_[i]]++] = {route, static_cast<uint32_t>(i - routeOffsets_[route])};
+            }
+        }
+    }
+
+    std::vector<RaptorRouter::Journey> RaptorRouter::FindParetoJourneys(const Stop* from, const Stop* to,
+                                                                     const std::optional<TravelSetting>& customSetting) const {
+        const uint32_t fromIndex = from->id_;
+        const uint32_t toIndex = to->id_;
+
+        std::vector<Journey> journeys;
+        if(fromIndex == toIndex) {
+            journeys.push_back({0., 0, {}});
+            return journeys;
+        }
+
+        const TravelSetting setting = customSetting.value_or(defaultSetting_);
+        const Rounds rounds = RunRounds(fromIndex, toIndex, UNREACHABLE, setting);
+        for(size_t round = 1; round < rounds.arrivals.size(); ++round) {
+            if(rounds.arrivals[round][toIndex] < rounds.arrivals[round - 1][toIndex]) {
+                journeys.push_back(RestoreJourney(rounds.labels, round, toIndex, rounds.arrivals[round][toIndex], setting));
+            }
+        }
+        return journeys;
+    }
+
+    std::vector<double> RaptorRouter::FindArrivalTimes(const Stop* from, double timeBudget) const {
+        return RunRounds(from->id_, NO_STOP, timeBudget, defaultSetting_).bestArrivals;
+    }
+
+    RaptorRouter::Rounds RaptorRouter::RunRounds(uint32_t fromIndex, uint32_t toIndex, double timeBudget,
+                                                  const TravelSetting& setting) const {
+        const size_t stopCount = stopCount_;
+
+        Rounds rounds{{std::vector<double>(stopCount, UNREACHABLE)}, {std::vector<Label>(stopCount)},
+                      std::vector<double>(stopCount, UNREACHABLE)};
+        std::vector<std::vector<double>>& arrivals = rounds.arrivals;
+        std::vector<std::vector<Label>>& labels = rounds.labels;
+        std::vector<double>& bestArrivals = rounds.bestArrivals;
+        arrivals[0][fromIndex] = 0.;
+        bestArrivals[fromIndex] = 0.;
+
+        std::vector<uint32_t> markedStops{fromIndex};
+        std::vector<bool> isMarked(stopCount, false);
+        std::vector<uint32_t> firstPositions(routeOffsets_.size() - 1, NO_ROUTE);
+        std::vector<uint32_t> queuedRoutes;
+
+        for(size_t round = 1; !markedStops.empty(); ++round) {
+            // Каждый маршрут сканируется один раз, начиная с самой ранней отмеченной остановки
+            for(const uint32_t stop : markedStops) {
+                isMarked[stop] = false;
+                for(size_t i = stopRouteOffsets_[stop]; i < stopRouteOffsets_[stop + 1]; ++i) {
+                    const auto [route, position] = stopRoutes_[i];
+                    if(firstPositions[route] == NO_ROUTE) {
+                        queuedRoutes.push_back(route);
+                        firstPositions[route] = position;
+                    } else {
+                        firstPositions[route] = std::min(firstPositions[route], position);
+                    }
+                }
+            }
+            markedStops.clear();
+
+            arrivals.push_back(arrivals[round - 1]);
+            labels.emplace_back(stopCount);
+            const std::vector<double>& previousArrivals = arrivals[round - 1];
+            std::vector<double>& roundArrivals = arrivals[round];
+            std::vector<Label>& roundLabels = labels[round];
+
+            for(const uint32_t route : queuedRoutes) {
+                const size_t offset = routeOffsets_[route];
+                const size_t routeSize = routeOffsets_[route + 1] - offset;
+                bool isBoarded = false;
+                uint32_t boardPosition = 0;
+                double boardTime = 0.;
+                double boardDistance = 0.;
+                for(uint32_t position = firstPositions[route]; position < routeSize; ++position) {
+                    const uint32_t stop = routeStops_[offset + position];
+                    const double rideDistance = routeDistances_[offset + position] - boardDistance;
+                    if(isBoarded) {
+                        const double arrival = boardTime + ComputeRideTime(rideDistance, setting.busVelocity);
+                        // Прибытия позже бюджета и позже уже найденного прибытия в цель ничего не улучшат
+                        if(arrival < bestArrivals[stop] && arrival <= timeBudget
+                           && (toIndex == NO_STOP || arrival < bestArrivals[toIndex])) {
+                            roundArrivals[stop] = arrival;
+                            bestArrivals[stop] = arrival;
+                            roundLabels[stop] = {route, boardPosition, position};
+                            if(!isMarked[stop]) {
+                                isMarked[stop] = true;
+                                markedStops.push_back(stop);
+                            }
+                        }
+                    }
+                    if(previousArrivals[stop] != UNREACHABLE) {
+                        const double departure = previousArrivals[stop] + setting.busWaitTime;
+                        if(!isBoarded || departure < boardTime + ComputeRideTime(rideDistance, setting.busVelocity)) {
+                            isBoarded = true;
+                            boardPosition = position;
+                            boardTime = departure;
+                            boardDistance = routeDistances_[offset + position];
+                        }
+                    }
+                }
+                firstPositions[route] = NO_ROUTE;
+            }
+            queuedRoutes.clear();
+        }
+        return rounds;
+    }
+
+    std::optional<RaptorRouter::Journey> RaptorRouter::FindFastestJourney(const Stop* from, const Stop* to,
+                                                                        const std::optional<TravelSetting>& customSetting) const {
+        std::vector<Journey> journeys = FindParetoJourneys(from, to, customSetting);
+        if(journeys.empty()) {
+            return std::nullopt;
+        }
+        return std::move(journeys.back());
+    }
+
+    double RaptorRouter::ComputeRideTime(double distance, double busVelocity) {
+        double sInKm = distance / 1000;
+        double tInH = sInKm / busVelocity;
+        return tInH * 60;
+    }
+
+    // Поездки восстанавливаются от конца: метка раунда указывает, где была посадка, а время на остановке
+    // посадки задано меткой одного из предыдущих раундов
+    RaptorRouter::Journey RaptorRouter::RestoreJourney(const std::vector<std::vector<Label>>& labels, size_t round,
+                                                       uint32_t to, double totalTime, const TravelSetting& setting) const {
+        std::vector<Leg> legs;
+        uint32_t stop = to;
+        for(; round > 0; --round) {
+            const Label& label = labels[round][stop];
+            if(label.route == NO_ROUTE) {
+                continue;
+            }
+            const size_t offset = routeOffsets_[label.route];
+            const double rideDistance = routeDistances_[offset + label.alightPosition] - routeDistances_[offset + label.boardPosition];
+            stop = routeStops_[offset + label.boardPosition];
+            legs.push_back({label.route, stop,
+                            static_cast<int>(label.alightPosition - label.boardPosition),
+                            ComputeRideTime(rideDistance, setting.busVelocity)});
+        }
+        std::reverse(legs.begin(), legs.end());
+        const size_t transfers = legs.empty() ? 0 : legs.size() - 1;
+        return {totalTime, transfers, std::move(legs)};
+    }
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "transport_catalogue.h"
+
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace transport_router {
+
+    using transport_catalogue::Stop;
+    using transport_catalogue::Bus;
+    using transport_catalogue::TransportCatalogue;
+
+    // Поиск маршрутов алгоритмом RAPTOR прямо по массивам остановок автобусов, без графа.
+    // k-й раунд находит лучшее время прибытия на остановки ровно с k посадками, поэтому по раундам
+    // получается множество Парето по паре (время в пути, число пересадок).
+    class RaptorRouter {
+    public:
+        // id автобуса и остановки посадки
+        struct Leg {
+            uint32_t bus;
+            uint32_t boardStop;
+            int spanCount;
+            double rideTime;
+        };
+
+        struct Journey {
+            double totalTime;
+            size_t transfers;
+            std::vector<Leg> legs;
+        };
+
+        // Время ожидания и скорость автобуса входят только в поиск, поэтому запрос может передать свои
+        struct TravelSetting {
+            double busWaitTime;
+            double busVelocity;
+        };
+
+        RaptorRouter(const TransportCatalogue& db, double busWaitTime, double busVelocity);
+
+        // Маршруты упорядочены по возрастанию числа пересадок и убыванию времени в пути.
+        // Без customSetting берутся время ожидания и скорость, заданные при построении
+        [[nodiscard]] std::vector<Journey> FindParetoJourneys(const Stop* from, const Stop* to,
+                                                              const std::optional<TravelSetting>& customSetting = std::nullopt) const;
+        [[nodiscard]] std::optional<Journey> FindFastestJourney(const Stop* from, const Stop* to,
+                                                                const std::optional<TravelSetting>& customSetting = std::nullopt) const;
+        // Время в пути до каждой остановки (индексы как в TransportCatalogue::GetAllStops), не больше timeBudget,
+        // для остальных остановок - бесконечность
+        [[nodiscard]] std::vector<double> FindArrivalTimes(const Stop* from, double timeBudget) const;
+
+    private:
+        struct Label {
+            uint32_t route = NO_ROUTE;
+            uint32_t boardPosition = 0;
+            uint32_t alightPosition = 0;
+        };
+
+        struct RoutePosition {
+            uint32_t route;
+            uint32_t position;
+        };
+
+        // Прибытия и метки по раундам и лучшие прибытия за все раунды
+        struct Rounds {
+            std::vector<std::vector<double>> arrivals;
+            std::vector<std::vector<Label>> labels;
+            std::vector<double> bestArrivals;
+        };
+
+        // Без цели (toIndex == NO_STOP) раунды идут, пока улучшаются прибытия в пределах timeBudget
+        [[nodiscard]] Rounds RunRounds(uint32_t fromIndex, uint32_t toIndex, double timeBudget, const TravelSetting& setting) const;
+        [[nodiscard]] static double ComputeRideTime(double distance, double busVelocity);
+        [[nodiscard]] Journey RestoreJourney(const std::vector<std::vector<Label>>& labels, size_t round,
+                                             uint32_t to, double totalTime, const TravelSetting& setting) const;
+
+        static constexpr uint32_t NO_ROUTE = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t NO_STOP = std::numeric_limits<uint32_t>::max();
+        static constexpr double UNREACHABLE = std::numeric_limits<double>::infinity();
+
+        TravelSetting defaultSetting_;
+
+        // id остановки - её индекс во всех массивах
+        size_t stopCount_;
+
+        // Маршрут с номером i - автобус с id i. Остановки маршрутов подряд,
+        // routeDistances_[i] - расстояние от начала маршрута до остановки i
+        std::vector<size_t> routeOffsets_;
+        std::vector<uint32_t> routeStops_;
+        std::vector<double> routeDistances_;
+
+        // Маршруты, проходящие через остановку, с позицией остановки в маршруте
+        std::vector<size_t> stopRouteOffsets_;
+        std::vector<RoutePosition> stopRoutes_;
+    };
+
+}
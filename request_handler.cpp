@@ -3,15 +3,15 @@
 
 RequestHandler::RequestHandler(const TransportCatalogue& db,
                                const MapRenderer& renderer,
-                               const TransportRouter& routeBuilder) :
-        db_(db), renderer_(renderer), routeBuilder_(routeBuilder){
+                               const TransportRouter& routeBuilder,
+                               size_t threadCount) :
+        db_(db), renderer_(renderer), routeBuilder_(routeBuilder), threadCount_(threadCount){
 }
 
 std::vector<geo::Coordinates> RequestHandler::GetAllStopsCoordinates() const {
     std::vector<Coordinates> allCoordinates;
 
-    auto buses = db_.GetAllBuses();
-    for(auto& [name, bus] : buses) {
+    for(const auto& bus : db_.GetBuses()) {
         for(auto& stop : bus.route_) {
             allCoordinates.push_back(stop->coordinates_);
         }
@@ -21,17 +21,15 @@ std::vector<geo::Coordinates> RequestHandler::GetAllStopsCoordinates() const {
 
 std::set<std::string_view> RequestHandler::GetBusesNamesByOrder() const {
     std::set<std::string_view> busesByOrder;
-    auto buses = db_.GetAllBuses();
-
-    for(auto &[name, route] : buses) {
-        busesByOrder.insert(name);
+    for(const auto& bus : db_.GetBuses()) {
+        busesByOrder.insert(bus.name_);
     }
     return busesByOrder;
 }
 
 std::vector<const Stop*> RequestHandler::GetStopsForRenderBusName(std::string_view busName) const {
     std::vector<const Stop*> finalStops;
-    auto bus = db_.GetBus(std::string(busName));
+    const auto& bus = db_.GetBus(busName);
     if(!bus.route_.empty()) {
         if(bus.isRoundtrip_) {
             finalStops.push_back(bus.route_[0]);
@@ -48,10 +46,8 @@ std::vector<const Stop*> RequestHandler::GetStopsForRenderBusName(std::string_vi
 StopsNamesAndCoordinates RequestHandler::GetAllBusesPoints() const {
     StopsNamesAndCoordinates busesPoints;
     std::set<std::string_view> busesByOrder = GetBusesNamesByOrder();
-    auto buses = db_.GetAllBuses();
-
     for(auto& name : busesByOrder) {
-        auto& bus = buses.at(name);
+        const auto& bus = db_.GetBus(name);
         std::vector<Coordinates> busStopPoints;
         for(auto& stop : bus.route_) {
             busStopPoints.push_back(stop->coordinates_);
@@ -65,8 +61,7 @@ AllStopsOnBusesByOrder RequestHandler::GetAllStopsOnBusesByOrder() const {
     AllStopsOnBusesByOrder stopsOnBusesByOrder;
     auto& allStops = db_.GetAllStops();
     for(auto& stop : allStops) {
-        auto busesWithStop = db_.GetStopInfo(std::string(stop.name_));
-        if(!busesWithStop.empty()) {
+        if(!db_.GetBusIdsByStop(stop.id_).empty()) {
             stopsOnBusesByOrder[stop.name_] = &stop;
         }
     }
@@ -172,8 +167,9 @@ void RequestHandler::ExecuteStopQuery(json::Dict& outDict, const json::Node& req
     using namespace std::literals;
     std::string stopName = request.AsDict().at("name"s).AsString();
     json::Array buses;
-    for (const auto &bus: db_.GetStopInfo(stopName)) {
-        buses.push_back(json::Builder{}.Value(std::string(bus)).Build());
+    const auto& allBuses = db_.GetBuses();
+    for (const uint32_t busId : db_.GetStopInfo(stopName)) {
+        buses.push_back(json::Builder{}.Value(allBuses[busId].name_).Build());
     }
     outDict.insert({"buses"s, buses});
 }
@@ -200,22 +196,151 @@ void RequestHandler::ExecuteRouteQuery(json::Dict& outDict, const json::Node& re
     using namespace std::literals;
     std::string routeFrom = request.AsDict().at("from"s).AsString();
     std::string routeTo = request.AsDict().at("to"s).AsString();
+    if(request.AsDict().count("pareto"s) && request.AsDict().at("pareto"s).AsBool()) {
+        ExecuteParetoRouteQuery(outDict, routeFrom, routeTo);
+        return;
+    }
+    if(request.AsDict().count("alternatives"s)) {
+        const int count = request.AsDict().at("alternatives"s).AsInt();
+        if(count < 1) {
+            outDict.insert({"error_message"s, json::Builder{}.Value("invalid alternatives count"s).Build()});
+            return;
+        }
+        ExecuteAlternativeRoutesQuery(outDict, routeFrom, routeTo, static_cast<size_t>(count));
+        return;
+    }
 
-    auto optimalRoute = routeBuilder_.GetOptimalRoute(routeFrom, routeTo);
-    if (!optimalRoute.has_value()) {
+    // Маршрут по умолчанию приходит из кэша без копирования, остальные заворачиваются в такой же указатель
+    using SharedRoute = transport_router::SharedRoute;
+    SharedRoute optimalRoute;
+    if(request.AsDict().count("departure_time"s)) {
+        if(!routeBuilder_.HasTimetable()) {
+            outDict.insert({"error_message"s, json::Builder{}.Value("no timetable"s).Build()});
+            return;
+        }
+        const double departureTime = request.AsDict().at("departure_time"s).AsDouble();
+        optimalRoute = std::make_shared<SharedRoute::element_type>(routeBuilder_.GetEarliestArrivalRoute(routeFrom, routeTo, departureTime));
+        if(optimalRoute->has_value()) {
+            outDict.insert({"arrival_time"s, json::Builder{}.Value(departureTime + optimalRoute->value().totalTime).Build()});
+        }
+    } else if(request.AsDict().count("bus_wait_time"s) || request.AsDict().count("bus_velocity"s)) {
+        // Свои время ожидания и скорость только для этого запроса, движок не перестраивается
+        transport_router::RoutingSetting setting = routeBuilder_.GetRoutingSetting();
+        if(request.AsDict().count("bus_wait_time"s)) {
+            setting.busWaitTime = request.AsDict().at("bus_wait_time"s).AsDouble();
+        }
+        if(request.AsDict().count("bus_velocity"s)) {
+            setting.busVelocity = request.AsDict().at("bus_velocity"s).AsDouble();
+        }
+        if(setting.busWaitTime < 0. || setting.busVelocity <= 0.) {
+            outDict.insert({"error_message"s, json::Builder{}.Value("invalid routing settings"s).Build()});
+            return;
+        }
+        optimalRoute = std::make_shared<SharedRoute::element_type>(routeBuilder_.GetOptimalRoute(routeFrom, routeTo, setting));
+    } else {
+        optimalRoute = routeBuilder_.GetOptimalRoute(routeFrom, routeTo);
+    }
+    if (!optimalRoute->has_value()) {
         outDict.insert({"error_message"s, json::Builder{}.Value("not found"s).Build()});
     } else {
-        outDict.insert({"total_time"s, json::Builder{}.Value(optimalRoute.value().totalTime).Build()});
+        outDict.insert({"total_time"s, json::Builder{}.Value(optimalRoute->value().totalTime).Build()});
         json::Array jsonArray;
-        for (auto &routeStep: optimalRoute.value().routeSteps) {
+        for (const auto& routeStep: optimalRoute->value().routeSteps) {
             json::Dict jsonDict;
-            routeStep->WriteInJsonDict(jsonDict);
+            transport_router::WriteInJsonDict(routeStep, db_, jsonDict);
             jsonArray.push_back(json::Builder{}.Value(jsonDict).Build());
         }
         outDict.insert({"items"s, json::Builder{}.Value(jsonArray).Build()});
     }
 }
 
+void RequestHandler::ExecuteParetoRouteQuery(json::Dict& outDict, const std::string& routeFrom, const std::string& routeTo) const {
+    using namespace std::literals;
+    auto paretoRoutes = routeBuilder_.GetParetoRoutes(routeFrom, routeTo);
+    if (paretoRoutes.empty()) {
+        outDict.insert({"error_message"s, json::Builder{}.Value("not found"s).Build()});
+        return;
+    }
+    json::Array routesArray;
+    for (auto &paretoRoute: paretoRoutes) {
+        json::Array jsonArray;
+        for (const auto& routeStep: paretoRoute.routeInfo.routeSteps) {
+            json::Dict jsonDict;
+            transport_router::WriteInJsonDict(routeStep, db_, jsonDict);
+            jsonArray.push_back(json::Builder{}.Value(jsonDict).Build());
+        }
+        routesArray.push_back(json::Builder{}.StartDict()
+                                      .Key("total_time"s).Value(paretoRoute.routeInfo.totalTime)
+                                      .Key("transfers"s).Value(static_cast<int>(paretoRoute.transfers))
+                                      .Key("items"s).Value(jsonArray)
+                                      .EndDict().Build());
+    }
+    outDict.insert({"routes"s, json::Builder{}.Value(routesArray).Build()});
+}
+
+void RequestHandler::ExecuteAlternativeRoutesQuery(json::Dict& outDict, const std::string& routeFrom, const std::string& routeTo,
+                                                   size_t count) const {
+    using namespace std::literals;
+    auto routes = routeBuilder_.GetAlternativeRoutes(routeFrom, routeTo, count, threadCount_);
+    if (routes.empty()) {
+        outDict.insert({"error_message"s, json::Builder{}.Value("not found"s).Build()});
+        return;
+    }
+    json::Array routesArray;
+    for (auto &route: routes) {
+        json::Array jsonArray;
+        for (const auto& routeStep: route.routeSteps) {
+            json::Dict jsonDict;
+            transport_router::WriteInJsonDict(routeStep, db_, jsonDict);
+            jsonArray.push_back(json::Builder{}.Value(jsonDict).Build());
+        }
+        routesArray.push_back(json::Builder{}.StartDict()
+                                      .Key("total_time"s).Value(route.totalTime)
+                                      .Key("items"s).Value(jsonArray)
+                                      .EndDict().Build());
+    }
+    outDict.insert({"routes"s, json::Builder{}.Value(routesArray).Build()});
+}
+
+// Ответ - только матрица времён в пути, null там, где маршрута нет
+void RequestHandler::ExecuteRouteMatrixQuery(json::Dict& outDict, const json::Node& request) const {
+    using namespace std::literals;
+    std::vector<std::string> routesFrom;
+    for (const auto& node : request.AsDict().at("from"s).AsArray()) {
+        routesFrom.push_back(node.AsString());
+    }
+    std::vector<std::string> routesTo;
+    for (const auto& node : request.AsDict().at("to"s).AsArray()) {
+        routesTo.push_back(node.AsString());
+    }
+
+    json::Array rows;
+    rows.reserve(routesFrom.size());
+    for (const auto& row : routeBuilder_.GetRouteMatrix(routesFrom, routesTo, threadCount_)) {
+        json::Array times;
+        times.reserve(row.size());
+        for (const auto& totalTime : row) {
+            times.push_back(totalTime.has_value() ? json::Node(totalTime.value()) : json::Node(nullptr));
+        }
+        rows.push_back(std::move(times));
+    }
+    outDict.insert({"total_times"s, std::move(rows)});
+}
+
+void RequestHandler::ExecuteIsochroneQuery(json::Dict& outDict, const json::Node& request) const {
+    using namespace std::literals;
+    const std::string stopName = request.AsDict().at("stop"s).AsString();
+    const double timeBudget = request.AsDict().at("time_budget"s).AsDouble();
+    json::Array stops;
+    for (const auto& [stop, totalTime] : routeBuilder_.GetReachableStops(stopName, timeBudget)) {
+        stops.push_back(json::Builder{}.StartDict()
+                                .Key("stop_name"s).Value(stop->name_)
+                                .Key("total_time"s).Value(totalTime)
+                                .EndDict().Build());
+    }
+    outDict.insert({"stops"s, std::move(stops)});
+}
+
 json::Document RequestHandler::ExecuteQuery(const json::Document& doc) const {
     using namespace std::literals;
     auto &node = doc.GetRoot();
@@ -233,11 +358,17 @@ json::Document RequestHandler::ExecuteQuery(const json::Document& doc) const {
                 ExecuteMapQuery(dict);
             }  else if (request.AsDict().at("type"s).AsString() == "Route"s) {
                 ExecuteRouteQuery(dict, request);
+            } else if (request.AsDict().at("type"s).AsString() == "RouteMatrix"s) {
+                ExecuteRouteMatrixQuery(dict, request);
+            } else if (request.AsDict().at("type"s).AsString() == "Isochrone"s) {
+                ExecuteIsochroneQuery(dict, request);
             } else {
                 assert(request.AsDict().at("type"s).AsString() == "Bus"s ||
                        request.AsDict().at("type"s).AsString() == "Stop"s ||
                        request.AsDict().at("type"s).AsString() == "Map"s ||
-                       request.AsDict().at("type"s).AsString() == "Route"s);
+                       request.AsDict().at("type"s).AsString() == "Route"s ||
+                       request.AsDict().at("type"s).AsString() == "RouteMatrix"s ||
+                       request.AsDict().at("type"s).AsString() == "Isochrone"s);
             }
         }
         catch (...) {
@@ -24,7 +24,8 @@ class RequestHandler {
 
 public:
 
-    RequestHandler(const TransportCatalogue& db, const MapRenderer& renderer, const TransportRouter& routeBuilder);
+    RequestHandler(const TransportCatalogue& db, const MapRenderer& renderer, const TransportRouter& routeBuilder,
+                   size_t threadCount = 1);
 
     void RenderMap(std::ostream& out) const;
     void RenderLines(svg::Document& doc, SphereProjector& sphereProjector) const;
@@ -39,6 +40,7 @@ private:
     const TransportCatalogue& db_;
     const MapRenderer& renderer_;
     const TransportRouter& routeBuilder_;
+    size_t threadCount_;
 
     std::vector<const Stop*> GetStopsForRenderBusName(std::string_view busName) const;
     std::set<std::string_view> GetBusesNamesByOrder() const;
@@ -50,5 +52,10 @@ private:
     void ExecuteBusQuery(json::Dict& outDict, const json::Node& request) const;
     void ExecuteMapQuery(json::Dict& outDict) const;
     void ExecuteRouteQuery(json::Dict& outDict, const json::Node& request) const;
+    void ExecuteParetoRouteQuery(json::Dict& outDict, const std::string& routeFrom, const std::string& routeTo) const;
+    void ExecuteAlternativeRoutesQuery(json::Dict& outDict, const std::string& routeFrom, const std::string& routeTo,
+                                       size_t count) const;
+    void ExecuteRouteMatrixQuery(json::Dict& outDict, const json::Node& request) const;
+    void ExecuteIsochroneQuery(json::Dict& outDict, const json::Node& request) const;
 
 };
\ No newline at end of file
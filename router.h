@@ -1,12 +1,18 @@
 #pragma once
 
-#include "graph.h"
+#include "compact_graph.h"
+#include "parallel.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <queue>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -14,104 +20,381 @@
 
 namespace graph {
 
+    // Общий интерфейс движков поиска маршрутов поверх CompactGraph
     template <typename Weight>
-    class Router {
-    private:
-        using Graph = DirectedWeightedGraph<Weight>;
-
+    class RouterBase {
     public:
-
-        explicit Router(const Graph& graph);
-
         struct RouteInfo {
             Weight weight;
             std::vector<EdgeId> edges;
         };
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        virtual ~RouterBase() = default;
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // Веса путей из from до каждой вершины targets без восстановления рёбер, nullopt - пути нет.
+        // Движки с таблицей или деревом кратчайших путей переопределяют его, чтобы обойтись одним поиском.
+        virtual std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const {
+            std::vector<std::optional<Weight>> weights;
+            weights.reserve(targets.size());
+            for (const VertexId to : targets) {
+                auto route = BuildRoute(from, to);
+                weights.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+            }
+            return weights;
+        }
+    };
+
+    // Таблица маршрутов V x V в виде двух построчных массивов: веса и идентификаторы последних рёбер пути.
+    // Недостижимость кодируется бесконечным весом, отсутствие предыдущего ребра - NO_EDGE.
+    // В таком же виде таблица хранится в файле базы, поэтому её можно отобразить в память без копирования.
+    template <typename Weight>
+    struct RouteTableView {
+        using EdgeIndex = uint32_t;
+        static constexpr EdgeIndex NO_EDGE = std::numeric_limits<EdgeIndex>::max();
+
+        const Weight* weights = nullptr;
+        const EdgeIndex* prev_edges = nullptr;
+        size_t vertex_count = 0;
+        std::shared_ptr<const void> owner;
+
+        static size_t GetByteSize(size_t vertex_count) {
+            return vertex_count * vertex_count * (sizeof(Weight) + sizeof(EdgeIndex));
+        }
+
+        static RouteTableView FromBuffer(const char* data, size_t vertex_count, std::shared_ptr<const void> owner) {
+            RouteTableView view;
+            view.weights = reinterpret_cast<const Weight*>(data);
+            view.prev_edges = reinterpret_cast<const EdgeIndex*>(data + vertex_count * vertex_count * sizeof(Weight));
+            view.vertex_count = vertex_count;
+            view.owner = std::move(owner);
+            return view;
+        }
+    };
+
+    template <typename Weight>
+    class Router : public RouterBase<Weight> {
     private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        using GraphPtr = CompactGraphPtr<Weight>;
+        using EdgeIndex = typename RouteTableView<Weight>::EdgeIndex;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+
+        explicit Router(GraphPtr graph, size_t thread_count = 1);
+        Router(GraphPtr graph, RouteTableView<Weight> routeTable);
+        // Таблица previous, исправленная под graph - тот же граф, у которого изменились только веса рёбер.
+        // Дейкстрой заново считаются лишь строки, в которых кратчайшие пути могли измениться.
+        Router(GraphPtr graph, const Router& previous, size_t thread_count = 1);
 
-        void InitializeRoutesInternalData(const Graph& graph) {
-            const size_t vertex_count = graph.GetVertexCount();
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        std::vector<std::optional<Weight>> GetRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+        void WriteRouteTable(std::ostream& output) const;
+        // Сколько строк таблицы пересчитано при обновлении весов
+        size_t GetRecomputedRowCount() const;
+    private:
+        void InitializeRoutesInternalData() {
+            const size_t vertex_count = graph_->GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
+                const size_t row = vertex * vertex_count;
+                weights_[row + vertex] = ZERO_WEIGHT;
+                for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                    const Weight weight = graph_->GetSlotWeight(slot);
+                    const VertexId to = graph_->GetSlotTarget(slot);
+                    if (weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{edge.weight, edge_id};
+                    if (weights_[row + to] > weight) {
+                        weights_[row + to] = weight;
+                        prev_edges_[row + to] = static_cast<EdgeIndex>(graph_->GetSlotEdgeId(slot));
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                        const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = {candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+        // Минимум-плюс релаксация отрезка строки через промежуточную вершину без ветвлений,
+        // чтобы компилятор мог векторизовать цикл
+        static void RelaxRowSegment(Weight* weights_relaxing, EdgeIndex* prev_edges_relaxing,
+                                    const Weight* weights_through, const EdgeIndex* prev_edges_through,
+                                    size_t count, Weight weight_from, EdgeIndex prev_edge_from) {
+            for (size_t i = 0; i < count; ++i) {
+                const Weight candidate_weight = weight_from + weights_through[i];
+                const bool is_better = candidate_weight < weights_relaxing[i];
+                const EdgeIndex prev_edge = prev_edges_through[i] != NO_EDGE ? prev_edges_through[i] : prev_edge_from;
+                weights_relaxing[i] = is_better ? candidate_weight : weights_relaxing[i];
+                prev_edges_relaxing[i] = is_better ? prev_edge : prev_edges_relaxing[i];
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+        // Флойд-Уоршелл, разбитый на блоки по PHASE_BLOCK_SIZE промежуточных вершин.
+        // Строки промежуточных вершин блока сначала проходят фазы блока по порядку и запоминаются
+        // в том виде, в каком их видит обычный алгоритм на своей фазе. Остальные строки независимы:
+        // они обрабатываются параллельно и по полосам столбцов, а каждая ячейка получает ту же
+        // последовательность операций, что и в последовательном алгоритме, поэтому результат совпадает побитово.
+        void ComputeRoutesInternalData(size_t vertex_count, size_t thread_count) {
+            std::vector<Weight> weights_through(PHASE_BLOCK_SIZE * vertex_count);
+            std::vector<EdgeIndex> prev_edges_through(PHASE_BLOCK_SIZE * vertex_count);
+
+            for (VertexId block_begin = 0; block_begin < vertex_count; block_begin += PHASE_BLOCK_SIZE) {
+                const VertexId block_end = std::min(vertex_count, block_begin + PHASE_BLOCK_SIZE);
+
+                for (VertexId vertex_through = block_begin; vertex_through < block_end; ++vertex_through) {
+                    const size_t through_row = vertex_through * vertex_count;
+                    const size_t snapshot_row = (vertex_through - block_begin) * vertex_count;
+                    std::copy_n(&weights_[through_row], vertex_count, &weights_through[snapshot_row]);
+                    std::copy_n(&prev_edges_[through_row], vertex_count, &prev_edges_through[snapshot_row]);
+                    for (VertexId vertex_from = block_begin; vertex_from < block_end; ++vertex_from) {
+                        const size_t row = vertex_from * vertex_count;
+                        if (vertex_from == vertex_through || weights_[row + vertex_through] == UNREACHABLE) {
+                            continue;
                         }
+                        RelaxRowSegment(&weights_[row], &prev_edges_[row],
+                                        &weights_through[snapshot_row], &prev_edges_through[snapshot_row],
+                                        vertex_count, weights_[row + vertex_through], prev_edges_[row + vertex_through]);
                     }
                 }
+
+                const size_t other_row_count = vertex_count - (block_end - block_begin);
+                parallel::ParallelFor(other_row_count, thread_count, [&](size_t index) {
+                    const VertexId vertex_from = index < block_begin ? index : index + (block_end - block_begin);
+                    RelaxRowThroughBlock(vertex_count, vertex_from, block_begin, block_end,
+                                         weights_through.data(), prev_edges_through.data());
+                });
+            }
+        }
+
+        void RelaxRowThroughBlock(size_t vertex_count, VertexId vertex_from, VertexId block_begin, VertexId block_end,
+                                  const Weight* weights_through, const EdgeIndex* prev_edges_through) {
+            Weight* weights_relaxing = &weights_[vertex_from * vertex_count];
+            EdgeIndex* prev_edges_relaxing = &prev_edges_[vertex_from * vertex_count];
+            const size_t block_size = block_end - block_begin;
+
+            // Значения в столбцах блока на момент соответствующей фазы
+            Weight weights_from[PHASE_BLOCK_SIZE];
+            EdgeIndex prev_edges_from[PHASE_BLOCK_SIZE];
+            for (size_t phase = 0; phase < block_size; ++phase) {
+                weights_from[phase] = weights_relaxing[block_begin + phase];
+                prev_edges_from[phase] = prev_edges_relaxing[block_begin + phase];
+                if (weights_from[phase] != UNREACHABLE) {
+                    const size_t snapshot_row = phase * vertex_count + block_begin;
+                    RelaxRowSegment(weights_relaxing + block_begin, prev_edges_relaxing + block_begin,
+                                    weights_through + snapshot_row, prev_edges_through + snapshot_row,
+                                    block_size, weights_from[phase], prev_edges_from[phase]);
+                }
+            }
+
+            auto relax_columns = [&](size_t column_begin, size_t column_end) {
+                for (size_t tile_begin = column_begin; tile_begin < column_end; tile_begin += COLUMN_TILE_SIZE) {
+                    const size_t tile_size = std::min(column_end - tile_begin, COLUMN_TILE_SIZE);
+                    for (size_t phase = 0; phase < block_size; ++phase) {
+                        if (weights_from[phase] == UNREACHABLE) {
+                            continue;
+                        }
+                        const size_t snapshot_row = phase * vertex_count + tile_begin;
+                        RelaxRowSegment(weights_relaxing + tile_begin, prev_edges_relaxing + tile_begin,
+                                        weights_through + snapshot_row, prev_edges_through + snapshot_row,
+                                        tile_size, weights_from[phase], prev_edges_from[phase]);
+                    }
+                }
+            };
+            relax_columns(0, block_begin);
+            relax_columns(block_end, vertex_count);
+        }
+
+        // Строка from устарела, если её дерево путей содержит подорожавшее ребро или через подешевевшее
+        // ребро можно улучшить путь до его конца. В остальных строках пути и веса остаются кратчайшими.
+        bool IsRowStale(VertexId from, const std::vector<EdgeId>& increased_edges,
+                        const std::vector<EdgeId>& decreased_edges) const {
+            const size_t row = from * graph_->GetVertexCount();
+            for (const EdgeId edge_id : increased_edges) {
+                if (prev_edges_[row + graph_->GetEdge(edge_id).to] == static_cast<EdgeIndex>(edge_id)) {
+                    return true;
+                }
+            }
+            for (const EdgeId edge_id : decreased_edges) {
+                const Edge<Weight> edge = graph_->GetEdge(edge_id);
+                const Weight weight_from = weights_[row + edge.from];
+                if (weight_from != UNREACHABLE && weight_from + edge.weight < weights_[row + edge.to]) {
+                    return true;
+                }
             }
+            return false;
         }
 
+        // Строка таблицы целиком, алгоритмом Дейкстры из from
+        void ComputeRow(VertexId from) {
+            const size_t vertex_count = graph_->GetVertexCount();
+            Weight* weights = &weights_[from * vertex_count];
+            EdgeIndex* prev_edges = &prev_edges_[from * vertex_count];
+            std::fill_n(weights, vertex_count, UNREACHABLE);
+            std::fill_n(prev_edges, vertex_count, NO_EDGE);
+
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+            weights[from] = ZERO_WEIGHT;
+            queue.push({ZERO_WEIGHT, from});
+            while (!queue.empty()) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > weights[vertex]) {
+                    continue;
+                }
+                for (size_t slot = graph_->GetFirstSlot(vertex); slot < graph_->GetLastSlot(vertex); ++slot) {
+                    const VertexId to = graph_->GetSlotTarget(slot);
+                    const Weight candidate_weight = weight + graph_->GetSlotWeight(slot);
+                    if (candidate_weight < weights[to]) {
+                        weights[to] = candidate_weight;
+                        prev_edges[to] = static_cast<EdgeIndex>(graph_->GetSlotEdgeId(slot));
+                        queue.push({candidate_weight, to});
+                    }
+                }
+            }
+        }
+
+        static constexpr size_t PHASE_BLOCK_SIZE = 32;
+        static constexpr size_t COLUMN_TILE_SIZE = 1024;
         static constexpr Weight ZERO_WEIGHT{};
-        Graph graph_;
-        RoutesInternalData routes_internal_data_;
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::infinity();
+        static constexpr EdgeIndex NO_EDGE = RouteTableView<Weight>::NO_EDGE;
+
+        GraphPtr graph_;
+        std::vector<Weight> weights_;
+        std::vector<EdgeIndex> prev_edges_;
+        RouteTableView<Weight> route_table_;
+        size_t recomputed_row_count_ = 0;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
-            : graph_(graph)
-            , routes_internal_data_(graph.GetVertexCount(),
-                                    std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    Router<Weight>::Router(GraphPtr graph, size_t thread_count)
+            : graph_(std::move(graph))
+            , weights_(graph_->GetVertexCount() * graph_->GetVertexCount(), UNREACHABLE)
+            , prev_edges_(graph_->GetVertexCount() * graph_->GetVertexCount(), NO_EDGE)
     {
-        InitializeRoutesInternalData(graph);
+        if (graph_->GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the route table");
+        }
+        InitializeRoutesInternalData();
+
+        const size_t vertex_count = graph_->GetVertexCount();
+        ComputeRoutesInternalData(vertex_count, thread_count);
+        route_table_.weights = weights_.data();
+        route_table_.prev_edges = prev_edges_.data();
+        route_table_.vertex_count = vertex_count;
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight>
+    Router<Weight>::Router(GraphPtr graph, RouteTableView<Weight> routeTable)
+            : graph_(std::move(graph))
+            , route_table_(std::move(routeTable))
+    {
+        if (route_table_.vertex_count != graph_->GetVertexCount()) {
+            throw std::invalid_argument("Route table doesn't match the graph");
         }
     }
 
+    template <typename Weight>
+    Router<Weight>::Router(GraphPtr graph, const Router& previous, size_t thread_count)
+            : graph_(std::move(graph))
+    {
+        const size_t vertex_count = graph_->GetVertexCount();
+        if (vertex_count != previous.route_table_.vertex_count || graph_->GetEdgeCount() != previous.graph_->GetEdgeCount()) {
+            throw std::invalid_argument("Route table doesn't match the graph");
+        }
+        std::vector<EdgeId> increased_edges;
+        std::vector<EdgeId> decreased_edges;
+        for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+            const Edge<Weight> edge = graph_->GetEdge(edge_id);
+            const Edge<Weight> previous_edge = previous.graph_->GetEdge(edge_id);
+            if (edge.from != previous_edge.from || edge.to != previous_edge.to) {
+                throw std::invalid_argument("Route table doesn't match the graph");
+            }
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.weight > previous_edge.weight) {
+                increased_edges.push_back(edge_id);
+            } else if (edge.weight < previous_edge.weight) {
+                decreased_edges.push_back(edge_id);
+            }
+        }
+
+        const size_t cell_count = vertex_count * vertex_count;
+        weights_.assign(previous.route_table_.weights, previous.route_table_.weights + cell_count);
+        prev_edges_.assign(previous.route_table_.prev_edges, previous.route_table_.prev_edges + cell_count);
+
+        std::vector<VertexId> stale_rows;
+        if (!increased_edges.empty() || !decreased_edges.empty()) {
+            for (VertexId from = 0; from < vertex_count; ++from) {
+                if (IsRowStale(from, increased_edges, decreased_edges)) {
+                    stale_rows.push_back(from);
+                }
+            }
+        }
+        parallel::ParallelFor(stale_rows.size(), thread_count, [&](size_t index) {
+            ComputeRow(stale_rows[index]);
+        });
+        recomputed_row_count_ = stale_rows.size();
+
+        route_table_.weights = weights_.data();
+        route_table_.prev_edges = prev_edges_.data();
+        route_table_.vertex_count = vertex_count;
+    }
+
+    template <typename Weight>
+    size_t Router<Weight>::GetRecomputedRowCount() const {
+        return recomputed_row_count_;
+    }
+
+    template <typename Weight>
+    void Router<Weight>::WriteRouteTable(std::ostream& output) const {
+        const size_t cell_count = route_table_.vertex_count * route_table_.vertex_count;
+        output.write(reinterpret_cast<const char*>(route_table_.weights),
+                     static_cast<std::streamsize>(cell_count * sizeof(Weight)));
+        output.write(reinterpret_cast<const char*>(route_table_.prev_edges),
+                     static_cast<std::streamsize>(cell_count * sizeof(EdgeIndex)));
+    }
+
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                                  VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        const size_t vertex_count = route_table_.vertex_count;
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const size_t row = from * vertex_count;
+        const Weight weight = route_table_.weights[row + to];
+        if (weight == UNREACHABLE) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-             edge_id;
-             edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (EdgeIndex edge_id = route_table_.prev_edges[row + to];
+             edge_id != NO_EDGE;
+             edge_id = route_table_.prev_edges[row + graph_->GetEdge(edge_id).from])
         {
-            edges.push_back(*edge_id);
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{weight, std::move(edges)};
     }
 
-}  // namespace graph
\ No newline at end of file
+    template <typename Weight>
+    std::vector<std::optional<Weight>> Router<Weight>::GetRouteWeights(VertexId from,
+                                                                       const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = route_table_.vertex_count;
+        if (from >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const Weight* row = route_table_.weights + from * vertex_count;
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(targets.size());
+        for (const VertexId to : targets) {
+            if (to >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            weights.push_back(row[to] == UNREACHABLE ? std::nullopt : std::optional<Weight>(row[to]));
+        }
+        return weights;
+    }
+
+}  // namespace graph
@@ -2,6 +2,74 @@
 
 namespace serialization {
 
+    namespace {
+        // Файл базы: сообщение Base, затем (если есть) выровненная по странице таблица маршрутов
+        // graph::Router в формате RouteTableView и в самом конце RouteTableFooter.
+        struct RouteTableFooter {
+            uint64_t magic;
+            uint64_t baseSize;
+            uint64_t tableOffset;
+            uint64_t vertexCount;
+        };
+
+        constexpr uint64_t ROUTE_TABLE_MAGIC = 0x534554554F524354; // "TCROUTES"
+        constexpr uint64_t ROUTE_TABLE_ALIGNMENT = 4096;
+
+        void WriteRouteTableSection(std::ostream& output, uint64_t baseSize,
+                                    const transport_router::TransportRouter& router) {
+            const uint64_t tableOffset = (baseSize + ROUTE_TABLE_ALIGNMENT - 1) / ROUTE_TABLE_ALIGNMENT * ROUTE_TABLE_ALIGNMENT;
+            const std::string padding(tableOffset - baseSize, '\0');
+            output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            static_cast<const transport_router::Router&>(router.GetRouter()).WriteRouteTable(output);
+            const RouteTableFooter footer{ROUTE_TABLE_MAGIC, baseSize, tableOffset, router.GetGraph().GetVertexCount()};
+            output.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+        }
+
+        std::optional<RouteTableFooter> ReadRouteTableFooter(const MappedFile& file) {
+            if(file.GetSize() < sizeof(RouteTableFooter)) {
+                return std::nullopt;
+            }
+            RouteTableFooter footer{};
+            std::copy_n(file.GetData() + file.GetSize() - sizeof(footer), sizeof(footer), reinterpret_cast<char*>(&footer));
+            if(footer.magic != ROUTE_TABLE_MAGIC || footer.baseSize > file.GetSize() - sizeof(footer)) {
+                return std::nullopt;
+            }
+            return footer;
+        }
+
+        bool IsRouteTableValid(const MappedFile& file, const RouteTableFooter& footer) {
+            const uint64_t tableSize = transport_router::RouteTableView::GetByteSize(footer.vertexCount);
+            return footer.baseSize <= footer.tableOffset && footer.tableOffset % ROUTE_TABLE_ALIGNMENT == 0 &&
+                   footer.tableOffset + tableSize + sizeof(footer) == file.GetSize();
+        }
+
+        serialization::HubLabelSet ConvertLabels(const transport_router::HubLabels::Labels& labels) {
+            serialization::HubLabelSet outLabels;
+            for(const size_t offset : labels.offsets) {
+                outLabels.add_offsets(offset);
+            }
+            for(const auto& entry : labels.entries) {
+                outLabels.add_hubs(entry.hub);
+                outLabels.add_edges(entry.edge);
+                outLabels.add_weights(entry.weight);
+            }
+            return outLabels;
+        }
+
+        transport_router::HubLabels::Labels ConvertLabels(const serialization::HubLabelSet& labels) {
+            if(labels.hubs_size() != labels.edges_size() || labels.hubs_size() != labels.weights_size()) {
+                throw std::invalid_argument("Hub labels are corrupted");
+            }
+            transport_router::HubLabels::Labels outLabels;
+            outLabels.offsets.assign(labels.offsets().begin(), labels.offsets().end());
+            outLabels.entries.reserve(labels.hubs_size());
+            for(int i = 0; i < labels.hubs_size(); ++i) {
+                outLabels.entries.push_back({labels.hubs(i), labels.edges(i), labels.weights(i)});
+            }
+            return outLabels;
+        }
+    }
+
     void Serialize(std::ostream& output,
                    const transport_catalogue::TransportCatalogue& catalogue,
                    const renderer::MapRenderer& mapRenderer,
@@ -11,26 +79,42 @@ namespace serialization {
         *base.mutable_router() = Convert(router);
         *base.mutable_catalogue() = Convert(catalogue);
         *base.mutable_renderer() = Convert(mapRenderer);
-        base.SerializeToOstream(&output);
-
+        const std::string baseBytes = base.SerializeAsString();
+        output.write(baseBytes.data(), static_cast<std::streamsize>(baseBytes.size()));
+        if(router.GetRoutingSetting().routerType == transport_router::RouterType::FloydWarshall) {
+            WriteRouteTableSection(output, baseBytes.size(), router);
+        }
     }
 
-    void Deserialize(std::istream& input,
+    void Deserialize(const std::string& filename,
                      transport_catalogue::TransportCatalogue& outCatalogue,
                      renderer::MapRenderer& outMapRenderer,
                      transport_router::TransportRouter& outRouter) {
 
+        const auto file = std::make_shared<MappedFile>(filename);
+        size_t baseSize = file->GetSize();
+        transport_router::RouteTableView routeTable;
+        if(const auto footer = ReadRouteTableFooter(*file)) {
+            baseSize = footer->baseSize;
+            if(IsRouteTableValid(*file, *footer)) {
+                routeTable = transport_router::RouteTableView::FromBuffer(file->GetData() + footer->tableOffset,
+                                                                          footer->vertexCount, file);
+            }
+        }
+
         serialization::Base base;
-        base.ParseFromIstream(&input);
-        outCatalogue = Convert(base.catalogue());
+        if(!base.ParseFromArray(file->GetData(), static_cast<int>(baseSize))) {
+            throw std::runtime_error("Can't parse transport catalogue base " + filename);
+        }
+        outCatalogue = Convert(base.catalogue(), base.router().timetable());
         outMapRenderer = Convert(base.renderer());
-        outRouter = Convert(base.router(), outCatalogue);
+        outRouter = Convert(base.router(), outCatalogue, std::move(routeTable));
     }
 
-    serialization::Graph Convert(const transport_router::Graph& graph) {
+    serialization::Graph Convert(const transport_router::CompactGraph& graph) {
         serialization::Graph outGraph;
-        const auto& edges = graph.GetEdges();
-        for(const auto& edge : edges) {
+        for(size_t edgeId = 0; edgeId < graph.GetEdgeCount(); ++edgeId) {
+            const auto edge = graph.GetEdge(edgeId);
             serialization::Edge toSerialEdge;
             toSerialEdge.set_from(edge.from);
             toSerialEdge.set_to(edge.to);
@@ -38,10 +122,9 @@ namespace serialization {
             outGraph.mutable_edges()->Add(std::move(toSerialEdge));
         }
 
-        const auto& incidenceLists = graph.GetIncidenceLists();
-        for(const auto& incidenceList : incidenceLists) {
+        for(size_t vertexId = 0; vertexId < graph.GetVertexCount(); ++vertexId) {
             serialization::IncidenceList toSerialIncidenceList;
-            for(const auto& edgeId : incidenceList) {
+            for(const auto edgeId : graph.GetIncidentEdges(vertexId)) {
                 toSerialIncidenceList.add_list(edgeId);
             }
             outGraph.mutable_incidence_lists()->Add(std::move(toSerialIncidenceList));
@@ -67,10 +150,21 @@ namespace serialization {
         return outGraph;
     }
 
+    serialization::NameIndex Convert(const transport_catalogue::PerfectHashIndex& index) {
+        serialization::NameIndex outIndex;
+        outIndex.mutable_displacements()->Add(index.GetDisplacements().begin(), index.GetDisplacements().end());
+        outIndex.mutable_ids()->Add(index.GetIds().begin(), index.GetIds().end());
+        return outIndex;
+    }
+
+    transport_catalogue::PerfectHashIndex Convert(const serialization::NameIndex& index) {
+        return transport_catalogue::PerfectHashIndex({index.displacements().begin(), index.displacements().end()},
+                                                     {index.ids().begin(), index.ids().end()});
+    }
+
     serialization::TransportCatalogue Convert(const transport_catalogue::TransportCatalogue& catalogue) {
         serialization::TransportCatalogue outCatalogue;
         const auto& stops = catalogue.GetAllStops();
-        std::unordered_map<const transport_catalogue::Stop*, size_t> stopToId;
         for(size_t i = 0; i < stops.size(); ++i) {
             serialization::Stop tempStop;
             tempStop.set_name(stops[i].name_);
@@ -78,7 +172,6 @@ namespace serialization {
             tempStop.mutable_coordinates()->set_lng(stops[i].coordinates_.lng);
             outCatalogue.add_stops();
             *(outCatalogue.mutable_stops(i)) = tempStop;
-            stopToId.emplace(&stops[i], i);
         }
 
         const auto& buses = catalogue.GetBuses();
@@ -86,51 +179,92 @@ namespace serialization {
             serialization::Bus tempBus;
             tempBus.set_name(bus.name_);
             for(const auto* stopPtr : bus.route_) {
-                tempBus.add_route(stopToId.at(stopPtr));
+                tempBus.add_route(stopPtr->id_);
             }
             tempBus.set_isroundtrip(bus.isRoundtrip_);
+            for(size_t i = 0; i < bus.route_.size(); ++i) {
+                tempBus.add_route_distances(bus.routeDistances_[i]);
+                tempBus.add_geo_distances(bus.geoDistances_[i]);
+            }
             outCatalogue.add_buses();
             *(outCatalogue.mutable_buses(outCatalogue.buses_size() - 1)) = tempBus;
         }
 
-        const auto& stopDistances = catalogue.GetStopDistances();
-        for(const auto& [stopPair, distance ] : stopDistances) {
-            serialization::StopDistance tempStopDistance;
-            tempStopDistance.set_stop1(stopToId.at(stopPair.first));
-            tempStopDistance.set_stop2(stopToId.at(stopPair.second));
-            tempStopDistance.set_distance(distance);
-            outCatalogue.add_stopdistances();
-            *(outCatalogue.mutable_stopdistances(outCatalogue.stopdistances_size() -1 )) = tempStopDistance;
+        catalogue.GetStopDistances().ForEach([&outCatalogue](const transport_catalogue::FlatDistanceTable::Entry& entry) {
+            serialization::StopDistance& tempStopDistance = *outCatalogue.add_stopdistances();
+            tempStopDistance.set_stop1(entry.from);
+            tempStopDistance.set_stop2(entry.to);
+            tempStopDistance.set_distance(entry.distance);
+        });
+        outCatalogue.set_geodistancemode(static_cast<uint32_t>(catalogue.GetGeoDistanceMode()));
+
+        for(const auto& stat : catalogue.GetBusStats()) {
+            serialization::BusStat& tempStat = *outCatalogue.add_bus_stats();
+            tempStat.set_stop_count(stat.stopCount);
+            tempStat.set_unique_stop_count(stat.uniqueStopCount);
+            tempStat.set_route_length(stat.routeLength);
+            tempStat.set_curvature(stat.curvature);
         }
+        outCatalogue.mutable_stop_bus_ids()->Add(catalogue.GetStopBusIds().begin(), catalogue.GetStopBusIds().end());
+        outCatalogue.mutable_stop_bus_offsets()->Add(catalogue.GetStopBusOffsets().begin(),
+                                                      catalogue.GetStopBusOffsets().end());
+        *outCatalogue.mutable_stop_name_index() = Convert(catalogue.GetStopNameIndex());
+        *outCatalogue.mutable_bus_name_index() = Convert(catalogue.GetBusNameIndex());
         return outCatalogue;
     }
 
-    transport_catalogue::TransportCatalogue Convert(const serialization::TransportCatalogue& catalogue) {
+    transport_catalogue::TransportCatalogue Convert(const serialization::TransportCatalogue& catalogue,
+                                                    const serialization::Timetable& timetable) {
         transport_catalogue::TransportCatalogue outCatalogue;
+        // Перегоны отсортированы по времени отправления, поэтому отправления каждого автобуса
+        // собираются уже по возрастанию
+        std::vector<std::vector<double>> departures(catalogue.buses_size());
+        for(const auto& connection : timetable.connections()) {
+            if(connection.position() == 0 && connection.bus() < departures.size()) {
+                departures[connection.bus()].push_back(connection.departure());
+            }
+        }
+        // Индексы имён из базы загружаются первыми, чтобы не заполнять хеш-таблицы имён
+        outCatalogue.SetNameIndices(Convert(catalogue.stop_name_index()), Convert(catalogue.bus_name_index()));
+        // Режим нужен, чтобы update_base пересчитывал расстояния так же, как make_base
+        outCatalogue.SetGeoDistanceMode(static_cast<geo::DistanceMode>(catalogue.geodistancemode()));
         for(size_t i = 0; i < catalogue.stops_size(); ++i) {
             const auto deserStop = catalogue.stops(i);
             outCatalogue.AddStop({deserStop.name(),
                                {deserStop.coordinates().lat(),
                                           deserStop.coordinates().lng()}});
         }
+        // Номера остановок в базе совпадают с их id в справочнике
+        const auto& stops = outCatalogue.GetAllStops();
+        std::vector<transport_catalogue::FlatDistanceTable::Entry> stopDistances;
+        stopDistances.reserve(catalogue.stopdistances_size());
+        for(const auto& stopDistance : catalogue.stopdistances()) {
+            if(stopDistance.stop1() >= stops.size() || stopDistance.stop2() >= stops.size()) {
+                throw std::out_of_range("Stop id is out of range");
+            }
+            stopDistances.push_back({stopDistance.stop1(), stopDistance.stop2(), static_cast<int>(stopDistance.distance())});
+        }
+        outCatalogue.LoadStopDistances(transport_catalogue::FlatDistanceTable(stopDistances));
         for(size_t i = 0; i < catalogue.buses_size(); ++i) {
             const auto& deserBus = catalogue.buses(i);
-            std::vector<const transport_catalogue::Stop*> stops;
+            std::vector<const transport_catalogue::Stop*> routeStops;
             for(size_t j = 0; j < deserBus.route_size(); ++j) {
-                const auto stopId = deserBus.route(j);
-                const auto& stopName = catalogue.stops(stopId).name();
-                stops.push_back(&outCatalogue.GetStop(stopName));
+                routeStops.push_back(&stops.at(deserBus.route(j)));
             }
-            outCatalogue.AddBus({deserBus.name(), stops, deserBus.isroundtrip()});
+            transport_catalogue::Bus bus{deserBus.name(), routeStops, deserBus.isroundtrip(), std::move(departures[i])};
+            bus.routeDistances_.assign(deserBus.route_distances().begin(), deserBus.route_distances().end());
+            bus.geoDistances_.assign(deserBus.geo_distances().begin(), deserBus.geo_distances().end());
+            outCatalogue.AddBus(bus);
         }
-        for(size_t i = 0; i < catalogue.stopdistances_size(); ++i) {
-            const auto& stopDistance = catalogue.stopdistances(i);
-            const auto& stopName1 = catalogue.stops(stopDistance.stop1()).name();
-            const auto& stopName2 = catalogue.stops(stopDistance.stop2()).name();
-            outCatalogue.SetStopsDistance(&outCatalogue.GetStop(stopName1),
-                                       &outCatalogue.GetStop(stopName2),
-                                       stopDistance.distance());
+
+        std::vector<transport_catalogue::BusStat> busStats;
+        busStats.reserve(catalogue.bus_stats_size());
+        for(const auto& stat : catalogue.bus_stats()) {
+            busStats.push_back({stat.stop_count(), stat.unique_stop_count(), stat.route_length(), stat.curvature()});
         }
+        outCatalogue.SetStatTables(std::move(busStats),
+                                   {catalogue.stop_bus_ids().begin(), catalogue.stop_bus_ids().end()},
+                                   {catalogue.stop_bus_offsets().begin(), catalogue.stop_bus_offsets().end()});
         return outCatalogue;
     }
 
@@ -159,11 +293,20 @@ namespace serialization {
         serialization::RoutingSettings outSettings;
         outSettings.set_buswaittime(settings.busWaitTime);
         outSettings.set_busvelocity(settings.busVelocity);
+        outSettings.set_routertype(static_cast<uint32_t>(settings.routerType));
+        outSettings.set_dijkstracachesize(settings.dijkstraCacheSize);
+        outSettings.set_cellsize(settings.cellSize);
+        outSettings.set_graphmodel(static_cast<uint32_t>(settings.graphModel));
+        outSettings.set_routecachesize(settings.routeCacheSize);
         return outSettings;
     }
 
     transport_router::RoutingSetting Convert(const serialization::RoutingSettings& settings) {
-        return {settings.buswaittime(), settings.busvelocity()};
+        return {settings.buswaittime(), settings.busvelocity(),
+                static_cast<transport_router::RouterType>(settings.routertype()),
+                settings.dijkstracachesize(), settings.cellsize(),
+                static_cast<transport_router::GraphModel>(settings.graphmodel()),
+                settings.routecachesize()};
     }
 
     renderer::RenderSettings Convert(const serialization::RenderSettings& settings) {
@@ -198,15 +341,126 @@ namespace serialization {
     }
 
 
+    serialization::ContractionHierarchy Convert(const transport_router::ContractionHierarchy& hierarchy) {
+        serialization::ContractionHierarchy outHierarchy;
+        for(const auto& shortcut : hierarchy.GetShortcuts()) {
+            serialization::Shortcut& outShortcut = *outHierarchy.add_shortcuts();
+            outShortcut.mutable_edge()->set_from(shortcut.edge.from);
+            outShortcut.mutable_edge()->set_to(shortcut.edge.to);
+            outShortcut.mutable_edge()->set_weight(shortcut.edge.weight);
+            outShortcut.set_first(shortcut.first);
+            outShortcut.set_second(shortcut.second);
+        }
+        for(const auto rank : hierarchy.GetRanks()) {
+            outHierarchy.add_ranks(rank);
+        }
+        return outHierarchy;
+    }
+
+    transport_router::ContractionHierarchy Convert(const serialization::ContractionHierarchy& hierarchy, transport_router::CompactGraphPtr graph) {
+        std::vector<transport_router::ContractionHierarchy::Shortcut> shortcuts;
+        shortcuts.reserve(hierarchy.shortcuts_size());
+        for(const auto& shortcut : hierarchy.shortcuts()) {
+            shortcuts.push_back({{shortcut.edge().from(), shortcut.edge().to(), shortcut.edge().weight()},
+                                 shortcut.first(), shortcut.second()});
+        }
+        std::vector<transport_router::ContractionHierarchy::Rank> ranks(hierarchy.ranks().begin(), hierarchy.ranks().end());
+        return {std::move(graph), std::move(shortcuts), std::move(ranks)};
+    }
+
+    serialization::HubLabels Convert(const transport_router::HubLabels& hubLabels) {
+        serialization::HubLabels outHubLabels;
+        *outHubLabels.mutable_forward_labels() = ConvertLabels(hubLabels.GetForwardLabels());
+        *outHubLabels.mutable_backward_labels() = ConvertLabels(hubLabels.GetBackwardLabels());
+        return outHubLabels;
+    }
+
+    transport_router::HubLabels Convert(const serialization::HubLabels& hubLabels, transport_router::CompactGraphPtr graph) {
+        return {std::move(graph), ConvertLabels(hubLabels.forward_labels()), ConvertLabels(hubLabels.backward_labels())};
+    }
+
+    serialization::PartitionOverlay Convert(const transport_router::PartitionOverlay& overlay) {
+        serialization::PartitionOverlay outOverlay;
+        for(const auto cell : overlay.GetCells()) {
+            outOverlay.add_cells(cell);
+        }
+        for(const double weight : overlay.GetCliqueWeights()) {
+            outOverlay.add_clique_weights(weight);
+        }
+        return outOverlay;
+    }
+
+    transport_router::PartitionOverlay Convert(const serialization::PartitionOverlay& overlay, transport_router::CompactGraphPtr graph) {
+        return {std::move(graph), std::vector<transport_router::PartitionOverlay::CellId>(overlay.cells().begin(), overlay.cells().end()),
+                std::vector<double>(overlay.clique_weights().begin(), overlay.clique_weights().end())};
+    }
+
+    serialization::Timetable Convert(const transport_router::ConnectionScanRouter& connectionScanRouter) {
+        serialization::Timetable outTimetable;
+        for(const auto& connection : connectionScanRouter.GetConnections()) {
+            serialization::Connection& outConnection = *outTimetable.add_connections();
+            outConnection.set_from_stop(connection.fromStop);
+            outConnection.set_to_stop(connection.toStop);
+            outConnection.set_departure(connection.departure);
+            outConnection.set_arrival(connection.arrival);
+            outConnection.set_trip(connection.trip);
+            outConnection.set_bus(connection.bus);
+            outConnection.set_position(connection.position);
+        }
+        return outTimetable;
+    }
+
+    transport_router::ConnectionScanRouter Convert(const serialization::Timetable& timetable, const transport_catalogue::TransportCatalogue& catalogue) {
+        std::vector<transport_router::ConnectionScanRouter::Connection> connections;
+        connections.reserve(timetable.connections_size());
+        for(const auto& connection : timetable.connections()) {
+            connections.push_back({connection.from_stop(), connection.to_stop(), connection.departure(), connection.arrival(),
+                                   connection.trip(), connection.bus(), connection.position()});
+        }
+        return {catalogue, std::move(connections)};
+    }
+
     serialization::Transport_router Convert(const transport_router::TransportRouter& router) {
         serialization::Transport_router outRouter;
         *outRouter.mutable_settings() = Convert(router.GetRoutingSetting());
         *outRouter.mutable_graph() = Convert(router.GetGraph());
+        if(router.HasTimetable()) {
+            *outRouter.mutable_timetable() = Convert(router.GetConnectionScanRouter());
+        }
+        if(router.GetRoutingSetting().routerType == transport_router::RouterType::ContractionHierarchy) {
+            *outRouter.mutable_contraction_hierarchy() =
+                    Convert(static_cast<const transport_router::ContractionHierarchy&>(router.GetRouter()));
+        } else if(router.GetRoutingSetting().routerType == transport_router::RouterType::HubLabels) {
+            *outRouter.mutable_hub_labels() = Convert(static_cast<const transport_router::HubLabels&>(router.GetRouter()));
+        } else if(router.GetRoutingSetting().routerType == transport_router::RouterType::PartitionOverlay) {
+            *outRouter.mutable_partition_overlay() =
+                    Convert(static_cast<const transport_router::PartitionOverlay&>(router.GetRouter()));
+        }
         return outRouter;
     }
 
-    transport_router::TransportRouter Convert(const serialization::Transport_router& router, const transport_catalogue::TransportCatalogue& catalogue) {
-        return {catalogue, Convert(router.settings()), Convert(router.graph())};
+    transport_router::TransportRouter Convert(const serialization::Transport_router& router, const transport_catalogue::TransportCatalogue& catalogue,
+                                              transport_router::RouteTableView routeTable) {
+        using transport_router::RouterType;
+        const transport_router::RoutingSetting settings = Convert(router.settings());
+        const auto graph = std::make_shared<const transport_router::CompactGraph>(Convert(router.graph()));
+        std::unique_ptr<transport_router::RouterBase> engine;
+        // Таблица от другого графа (старая или чужая база) не подходит, тогда BuildRouter посчитает её заново
+        if(settings.routerType == RouterType::FloydWarshall && routeTable.weights != nullptr
+           && routeTable.vertex_count == graph->GetVertexCount()) {
+            engine = std::make_unique<transport_router::Router>(graph, std::move(routeTable));
+        } else if(settings.routerType == RouterType::ContractionHierarchy && router.has_contraction_hierarchy()) {
+            engine = std::make_unique<transport_router::ContractionHierarchy>(Convert(router.contraction_hierarchy(), graph));
+        } else if(settings.routerType == RouterType::HubLabels && router.has_hub_labels()) {
+            engine = std::make_unique<transport_router::HubLabels>(Convert(router.hub_labels(), graph));
+        } else if(settings.routerType == RouterType::PartitionOverlay && router.has_partition_overlay()) {
+            engine = std::make_unique<transport_router::PartitionOverlay>(Convert(router.partition_overlay(), graph));
+        }
+        std::optional<transport_router::ConnectionScanRouter> connectionScanRouter;
+        if(router.timetable().connections_size() > 0) {
+            connectionScanRouter = Convert(router.timetable(), catalogue);
+        }
+        return {catalogue, settings, graph, std::move(engine), std::move(connectionScanRouter)};
     }
 
 }
\ No newline at end of file
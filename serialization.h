@@ -3,6 +3,7 @@
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "map_renderer.h"
+#include "mapped_file.h"
 #include <fstream>
 
 
@@ -13,25 +14,38 @@ namespace serialization {
                        const transport_catalogue::TransportCatalogue& catalogue,
                        const renderer::MapRenderer& mapRenderer,
                        const transport_router::TransportRouter& transportRouter);
-        void Deserialize(std::istream& input,
+        void Deserialize(const std::string& filename,
                          transport_catalogue::TransportCatalogue& outCatalogue,
                          renderer::MapRenderer& outMapRenderer,
                          transport_router::TransportRouter& transportRouter);
 
         [[nodiscard]] serialization::RenderSettings Convert(const renderer::RenderSettings& settings);
-        [[nodiscard]] serialization::Graph Convert(const transport_router::Graph& graph);
+        [[nodiscard]] serialization::Graph Convert(const transport_router::CompactGraph& graph);
+        [[nodiscard]] serialization::NameIndex Convert(const transport_catalogue::PerfectHashIndex& index);
         [[nodiscard]] serialization::TransportCatalogue Convert(const transport_catalogue::TransportCatalogue& catalogue);
         [[nodiscard]] serialization::RoutingSettings Convert(const transport_router::RoutingSetting& settings);
         [[nodiscard]] serialization::Transport_router Convert(const transport_router::TransportRouter& router);
         [[nodiscard]] serialization::Map_renderer Convert(const renderer::MapRenderer& map);
+        [[nodiscard]] serialization::ContractionHierarchy Convert(const transport_router::ContractionHierarchy& hierarchy);
+        [[nodiscard]] serialization::HubLabels Convert(const transport_router::HubLabels& hubLabels);
+        [[nodiscard]] serialization::PartitionOverlay Convert(const transport_router::PartitionOverlay& overlay);
+        [[nodiscard]] serialization::Timetable Convert(const transport_router::ConnectionScanRouter& connectionScanRouter);
 
 
         [[nodiscard]] transport_router::RoutingSetting Convert(const serialization::RoutingSettings& settings);
-        [[nodiscard]] transport_catalogue::TransportCatalogue Convert(const serialization::TransportCatalogue& catalogue);
+        [[nodiscard]] transport_catalogue::PerfectHashIndex Convert(const serialization::NameIndex& index);
+        // Отправления автобусов берутся из расписания маршрутизатора, в каталоге их копии нет
+        [[nodiscard]] transport_catalogue::TransportCatalogue Convert(const serialization::TransportCatalogue& catalogue,
+                                                                      const serialization::Timetable& timetable);
         [[nodiscard]] transport_router::Graph Convert(const serialization::Graph& graph);
         [[nodiscard]] renderer::RenderSettings Convert(const serialization::RenderSettings& settings);
-        [[nodiscard]] transport_router::TransportRouter Convert(const serialization::Transport_router& router, const transport_catalogue::TransportCatalogue& catalogue);
+        [[nodiscard]] transport_router::TransportRouter Convert(const serialization::Transport_router& router, const transport_catalogue::TransportCatalogue& catalogue,
+                                                                transport_router::RouteTableView routeTable = {});
         [[nodiscard]] renderer::MapRenderer Convert(const serialization::Map_renderer& map);
+        [[nodiscard]] transport_router::ContractionHierarchy Convert(const serialization::ContractionHierarchy& hierarchy, transport_router::CompactGraphPtr graph);
+        [[nodiscard]] transport_router::HubLabels Convert(const serialization::HubLabels& hubLabels, transport_router::CompactGraphPtr graph);
+        [[nodiscard]] transport_router::PartitionOverlay Convert(const serialization::PartitionOverlay& overlay, transport_router::CompactGraphPtr graph);
+        [[nodiscard]] transport_router::ConnectionScanRouter Convert(const serialization::Timetable& timetable, const transport_catalogue::TransportCatalogue& catalogue);
 
 
 }
\ No newline at end of file
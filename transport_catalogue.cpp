@@ -8,92 +8,264 @@ using transport_catalogue::BusInfo;
 
 void TransportCatalogue::AddStop(const Stop& stop) {
     Stop& ref = stops_.emplace_back(stop);
-    stopByName_.insert({ref.name_, ref});
-    busesByStopName[ref.name_];
+    ref.id_ = static_cast<uint32_t>(stops_.size() - 1);
+    if(ref.id_ >= stopNameIndex_.Size()) {
+        stopByName_.insert({ref.name_, ref});
+    }
+    stopCoordinates_.Add(ref.coordinates_);
+    ClearStatTables();
 }
+// Расстояния вдоль маршрута считаются сразу, поэтому расстояния между остановками лучше задать до добавления автобусов.
+// Уже посчитанные (например, загруженные из базы) расстояния не пересчитываются.
 void TransportCatalogue::AddBus(const Bus& bus) {
     Bus& ref = buses_.emplace_back(bus);
-    busByName_.insert({ref.name_, ref});
-    for(const Stop* stop : bus.route_) {
-        busesByStopName[stop->name_].insert(ref.name_);
+    ref.id_ = static_cast<uint32_t>(buses_.size() - 1);
+    if(ref.routeDistances_.size() != ref.route_.size() || ref.geoDistances_.size() != ref.route_.size()) {
+        ComputeBusDistances(ref);
+    }
+    if(ref.id_ >= busNameIndex_.Size()) {
+        busByName_.insert({ref.name_, ref});
+    }
+    ClearStatTables();
+}
+
+bool TransportCatalogue::AreStatTablesBuilt() const {
+    return busStats_.size() == buses_.size() && stopBusOffsets_.size() == stops_.size() + 1;
+}
+
+void TransportCatalogue::ClearStatTables() {
+    busStats_.clear();
+    stopBusIds_.clear();
+    stopBusOffsets_.clear();
+}
+
+void TransportCatalogue::BuildStatTables() {
+    busStats_.clear();
+    busStats_.reserve(buses_.size());
+    for(const Bus& bus : buses_) {
+        busStats_.push_back(ComputeBusStat(bus));
+    }
+
+    stopBusOffsets_.assign(stops_.size() + 1, 0);
+    for(const Bus& bus : buses_) {
+        for(const uint32_t stopId : bus.uniqueStops) {
+            ++stopBusOffsets_[stopId + 1];
+        }
+    }
+    for(size_t stopId = 0; stopId < stops_.size(); ++stopId) {
+        stopBusOffsets_[stopId + 1] += stopBusOffsets_[stopId];
+    }
+    stopBusIds_.resize(stopBusOffsets_.back());
+    std::vector<uint32_t> fillPositions(stopBusOffsets_.begin(), stopBusOffsets_.end() - 1);
+    for(const Bus& bus : buses_) {
+        for(const uint32_t stopId : bus.uniqueStops) {
+            stopBusIds_[fillPositions[stopId]++] = bus.id_;
+        }
+    }
+    for(size_t stopId = 0; stopId < stops_.size(); ++stopId) {
+        std::sort(stopBusIds_.begin() + stopBusOffsets_[stopId], stopBusIds_.begin() + stopBusOffsets_[stopId + 1],
+                  [this](uint32_t lhs, uint32_t rhs) {
+            return buses_[lhs].name_ < buses_[rhs].name_;
+        });
+    }
+}
+
+void TransportCatalogue::SetStatTables(std::vector<BusStat> busStats, std::vector<uint32_t> stopBusIds,
+                                       std::vector<uint32_t> stopBusOffsets) {
+    if(busStats.size() != buses_.size() || stopBusOffsets.size() != stops_.size() + 1
+       || stopBusOffsets.back() != stopBusIds.size()) {
+        throw std::invalid_argument("Stat tables don't match the catalogue");
     }
+    busStats_ = std::move(busStats);
+    stopBusIds_ = std::move(stopBusIds);
+    stopBusOffsets_ = std::move(stopBusOffsets);
+}
+
+const std::vector<transport_catalogue::BusStat>& TransportCatalogue::GetBusStats() const {
+    assert(AreStatTablesBuilt());
+    return busStats_;
+}
+
+transport_catalogue::BusIdsRange TransportCatalogue::GetBusIdsByStop(uint32_t stopId) const {
+    assert(AreStatTablesBuilt());
+    const uint32_t* busIds = stopBusIds_.data();
+    return {busIds + stopBusOffsets_[stopId], busIds + stopBusOffsets_[stopId + 1]};
+}
+
+const std::vector<uint32_t>& TransportCatalogue::GetStopBusIds() const {
+    assert(AreStatTablesBuilt());
+    return stopBusIds_;
+}
+
+const std::vector<uint32_t>& TransportCatalogue::GetStopBusOffsets() const {
+    assert(AreStatTablesBuilt());
+    return stopBusOffsets_;
+}
+
+void TransportCatalogue::BuildNameIndices() {
+    // При повторяющихся именах индекс не построить, тогда поиск остаётся на хеш-таблицах
+    if(stopByName_.size() != stops_.size() || busByName_.size() != buses_.size()) {
+        return;
+    }
+    std::vector<std::string_view> stopNames;
+    stopNames.reserve(stops_.size());
+    for(const Stop& stop : stops_) {
+        stopNames.push_back(stop.name_);
+    }
+    std::vector<std::string_view> busNames;
+    busNames.reserve(buses_.size());
+    for(const Bus& bus : buses_) {
+        busNames.push_back(bus.name_);
+    }
+    stopNameIndex_ = PerfectHashIndex(stopNames);
+    busNameIndex_ = PerfectHashIndex(busNames);
+    stopByName_.clear();
+    busByName_.clear();
+}
+
+void TransportCatalogue::SetNameIndices(PerfectHashIndex stopNameIndex, PerfectHashIndex busNameIndex) {
+    stopNameIndex_ = std::move(stopNameIndex);
+    busNameIndex_ = std::move(busNameIndex);
+}
+
+const transport_catalogue::PerfectHashIndex& TransportCatalogue::GetStopNameIndex() const {
+    return stopNameIndex_;
+}
+
+const transport_catalogue::PerfectHashIndex& TransportCatalogue::GetBusNameIndex() const {
+    return busNameIndex_;
 }
 
 void TransportCatalogue::SetStopsDistance(const Stop* stopFrom, const Stop* stopTo, int distance) {
-    stopDistances_[{stopFrom, stopTo}] = distance;
+    stopDistances_.Set(stopFrom->id_, stopTo->id_, distance);
+    for(Bus& bus : buses_) {
+        if(std::binary_search(bus.uniqueStops.begin(), bus.uniqueStops.end(), stopFrom->id_)) {
+            ComputeBusDistances(bus);
+            if(AreStatTablesBuilt()) {
+                busStats_[bus.id_] = ComputeBusStat(bus);
+            }
+        }
+    }
+}
+
+const Bus& TransportCatalogue::GetBus(std::string_view busName) const {
+    const Bus* bus = FindBus(busName);
+    if(!bus) {
+        throw std::out_of_range("Unknown bus");
+    }
+    return *bus;
 }
 
-const Bus& TransportCatalogue::GetBus(const std::string& busName) const {
-    return busByName_.at(busName);
+const Bus* TransportCatalogue::FindBus(std::string_view busName) const {
+    if(const auto id = busNameIndex_.FindCandidate(busName); id && *id < buses_.size() && buses_[*id].name_ == busName) {
+        return &buses_[*id];
+    }
+    const auto it = busByName_.find(busName);
+    return it == busByName_.end() ? nullptr : &it->second;
 }
 
 const std::deque<Bus>& TransportCatalogue::GetBuses() const {
     return buses_;
 }
 
-const Stop& TransportCatalogue::GetStop(const std::string& stopName) const {
-    return stopByName_.at(stopName);
+const Stop& TransportCatalogue::GetStop(std::string_view stopName) const {
+    const Stop* stop = FindStop(stopName);
+    if(!stop) {
+        throw std::out_of_range("Unknown stop");
+    }
+    return *stop;
 }
-BusInfo TransportCatalogue::GetBusInfo(const std::string& busName) const{
+
+const Stop* TransportCatalogue::FindStop(std::string_view stopName) const {
+    if(const auto id = stopNameIndex_.FindCandidate(stopName); id && *id < stops_.size() && stops_[*id].name_ == stopName) {
+        return &stops_[*id];
+    }
+    const auto it = stopByName_.find(stopName);
+    return it == stopByName_.end() ? nullptr : &it->second;
+}
+
+BusInfo TransportCatalogue::GetBusInfo(std::string_view busName) const{
     const Bus& bus = GetBus(busName);
-    double geo_distance = ComputeRouteDistance(bus);
-    double real_distance = ComputeRealRouteDistance(bus);
-    return {bus.name_, bus.route_.size(),
-            bus.uniqueStops.size(), real_distance, real_distance/geo_distance};
+    assert(AreStatTablesBuilt());
+    const BusStat& stat = busStats_[bus.id_];
+    return {bus.name_, stat.stopCount, stat.uniqueStopCount, stat.routeLength, stat.curvature};
 }
 
-const std::unordered_map<std::pair<const Stop*, const Stop*>, int, transport_catalogue::PairOfPointerHasher>& TransportCatalogue::GetStopDistances() const {
+const transport_catalogue::FlatDistanceTable& TransportCatalogue::GetStopDistances() const {
     return stopDistances_;
 }
 
-const std::unordered_map<std::string_view, const Bus&, std::hash<std::string_view>>&
-TransportCatalogue::GetAllBuses() const {
-    return busByName_;
+void TransportCatalogue::LoadStopDistances(FlatDistanceTable distances) {
+    stopDistances_ = std::move(distances);
 }
 
 const std::deque<Stop>& TransportCatalogue::GetAllStops() const {
     return stops_;
 }
 
-const std::set<std::string_view> TransportCatalogue::GetStopInfo(const std::string& name) const {
-    return busesByStopName.at(name);
+transport_catalogue::BusIdsRange TransportCatalogue::GetStopInfo(std::string_view name) const {
+    return GetBusIdsByStop(GetStop(name).id_);
 }
 
 double TransportCatalogue::ComputeRouteDistance(const Bus& bus) const {
-    double distance = 0;
-    for(size_t i = 0; i + 1 < bus.route_.size(); ++i) {
-        distance += ComputeDistance(bus.route_[i]->coordinates_, bus.route_[i + 1]->coordinates_);
-    }
-    return distance;
+    return bus.geoDistances_.empty() ? 0. : bus.geoDistances_.back();
 }
 
 double TransportCatalogue::ComputeRealRouteDistance(const Bus& bus) const {
-    double distance = 0;
-    for(size_t i = 0; i + 1 < bus.route_.size(); ++i) {
-        if(stopDistances_.count({bus.route_[i], bus.route_[i + 1]})) {
-            distance += stopDistances_.at({bus.route_[i], bus.route_[i + 1]});
-        } else if(stopDistances_.count({bus.route_[i + 1], bus.route_[i]})) {
-            distance += stopDistances_.at({bus.route_[i + 1], bus.route_[i]});
-        } else {
-            distance += ComputeDistance(bus.route_[i]->coordinates_, bus.route_[i + 1]->coordinates_);
-        }
-    }
-    return distance;
+    return bus.routeDistances_.empty() ? 0. : bus.routeDistances_.back();
 }
 
 double TransportCatalogue::ComputeRealStopToStopDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const {
-    double distance = 0;
-    while(indexFrom != indexTo) {
-        if(stopDistances_.count({bus.route_[indexFrom], bus.route_[indexFrom + 1]})) {
-            distance += stopDistances_.at({bus.route_[indexFrom], bus.route_[indexFrom + 1]});
-        } else if(stopDistances_.count({bus.route_[indexFrom + 1], bus.route_[indexFrom]})) {
-            distance += stopDistances_.at({bus.route_[indexFrom + 1], bus.route_[indexFrom]});
-        } else {
-            distance += ComputeDistance(bus.route_[indexFrom]->coordinates_, bus.route_[indexFrom + 1]->coordinates_);
-        }
-        ++indexFrom;
+    return SegmentDistance(bus, indexFrom, indexTo);
+}
+
+double TransportCatalogue::SegmentDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const {
+    return bus.routeDistances_[indexTo] - bus.routeDistances_[indexFrom];
+}
+
+double TransportCatalogue::SegmentGeoDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const {
+    return bus.geoDistances_[indexTo] - bus.geoDistances_[indexFrom];
+}
+
+void TransportCatalogue::SetGeoDistanceMode(geo::DistanceMode mode) {
+    geoDistanceMode_ = mode;
+}
+
+geo::DistanceMode TransportCatalogue::GetGeoDistanceMode() const {
+    return geoDistanceMode_;
+}
+
+const geo::CoordinatesTable& TransportCatalogue::GetStopCoordinates() const {
+    return stopCoordinates_;
+}
+
+double TransportCatalogue::ComputeRealNeighbourDistance(const Stop* stopFrom, const Stop* stopTo, double geoDistance) const {
+    const std::optional<int> distance = stopDistances_.Find(stopFrom->id_, stopTo->id_);
+    return distance ? *distance : geoDistance;
+}
+
+void TransportCatalogue::ComputeBusDistances(Bus& bus) const {
+    std::vector<uint32_t> path(bus.route_.size());
+    for(size_t i = 0; i < bus.route_.size(); ++i) {
+        path[i] = bus.route_[i]->id_;
     }
-    return distance;
+    std::vector<double> hopDistances;
+    geo::ComputeHopDistances(stopCoordinates_, path, hopDistances, geoDistanceMode_);
+
+    bus.routeDistances_.assign(bus.route_.size(), 0.);
+    bus.geoDistances_.assign(bus.route_.size(), 0.);
+    for(size_t i = 0; i + 1 < bus.route_.size(); ++i) {
+        bus.routeDistances_[i + 1] = bus.routeDistances_[i]
+                + ComputeRealNeighbourDistance(bus.route_[i], bus.route_[i + 1], hopDistances[i]);
+        bus.geoDistances_[i + 1] = bus.geoDistances_[i] + hopDistances[i];
+    }
+}
+
+transport_catalogue::BusStat TransportCatalogue::ComputeBusStat(const Bus& bus) const {
+    const double geoDistance = ComputeRouteDistance(bus);
+    const double realDistance = ComputeRealRouteDistance(bus);
+    return {static_cast<uint32_t>(bus.route_.size()), static_cast<uint32_t>(bus.uniqueStops.size()),
+            realDistance, realDistance / geoDistance};
 }
 
 void transport_catalogue::tests::AddingStop(TransportCatalogue& catalogue) {
@@ -149,6 +321,7 @@ void transport_catalogue::tests::AddingBus(TransportCatalogue& catalogue) {
 }
 void transport_catalogue::tests::GettingBusInfo(TransportCatalogue& catalogue) {
     AddingBus(catalogue);
+    catalogue.BuildStatTables();
     using namespace std::literals;
     BusInfo busInfo = catalogue.GetBusInfo("route66"s);
 
@@ -14,18 +14,15 @@
 #include <optional>
 #include "router.h"
 #include "domain.h"
+#include "flat_distance_table.h"
+#include "perfect_hash_index.h"
+#include "ranges.h"
 #include <iostream>
 
 namespace transport_catalogue {
 
-
-    class PairOfPointerHasher {
-    public:
-        size_t operator()(const std::pair<const Stop*, const Stop*>& pointers) const {
-            return reinterpret_cast<uintptr_t>(pointers.first) +
-                   reinterpret_cast<uintptr_t>(pointers.second) * 67;
-        }
-    };
+    // Номера автобусов одной остановки внутри общего массива, без копирования
+    using BusIdsRange = ranges::Range<const uint32_t*>;
 
     class TransportCatalogue {
 
@@ -35,35 +32,81 @@ namespace transport_catalogue {
         void AddStop(const Stop& stop);
         void AddBus(const Bus& bus);
         void SetStopsDistance(const Stop* stopFrom, const Stop* stopTo, int distance);
-        const Bus& GetBus(const std::string& busName) const;
+        // Поиск по имени без выделения памяти; Get* бросают std::out_of_range, Find* возвращают nullptr
+        const Bus& GetBus(std::string_view busName) const;
+        const Bus* FindBus(std::string_view busName) const;
         const std::deque<Bus>& GetBuses() const;
-        const Stop& GetStop(const std::string& stopName) const;
-        BusInfo GetBusInfo(const std::string& busName) const;
-        const std::unordered_map<std::pair<const Stop*, const Stop*>, int, transport_catalogue::PairOfPointerHasher>& GetStopDistances() const;
-        const std::set<std::string_view> GetStopInfo(const std::string& stopName) const;
-        const std::unordered_map<std::string_view, const Bus&, std::hash<std::string_view>>& GetAllBuses() const;
+        const Stop& GetStop(std::string_view stopName) const;
+        const Stop* FindStop(std::string_view stopName) const;
+        // Ответ на запрос Bus из таблицы, построенной BuildStatTables или загруженной из базы
+        BusInfo GetBusInfo(std::string_view busName) const;
+        const FlatDistanceTable& GetStopDistances() const;
+        // Загружает все расстояния по дорогам разом; вызывается до добавления автобусов
+        void LoadStopDistances(FlatDistanceTable distances);
+        // Номера автобусов, проходящих через остановку, по возрастанию названий
+        BusIdsRange GetStopInfo(std::string_view stopName) const;
         const std::deque<Stop>& GetAllStops() const;
+        // Способ расчёта расстояний по прямой; задаётся до добавления автобусов
+        void SetGeoDistanceMode(geo::DistanceMode mode);
+        geo::DistanceMode GetGeoDistanceMode() const;
+        // Координаты остановок по номеру остановки
+        const geo::CoordinatesTable& GetStopCoordinates() const;
+
+        // Таблицы ответов на запросы Bus и Stop строятся после добавления всех автобусов,
+        // дальше SetStopsDistance поддерживает их сам. AddStop и AddBus сбрасывают таблицы
+        void BuildStatTables();
+        void SetStatTables(std::vector<BusStat> busStats, std::vector<uint32_t> stopBusIds,
+                           std::vector<uint32_t> stopBusOffsets);
+        const std::vector<BusStat>& GetBusStats() const;
+        BusIdsRange GetBusIdsByStop(uint32_t stopId) const;
+        const std::vector<uint32_t>& GetStopBusIds() const;
+        const std::vector<uint32_t>& GetStopBusOffsets() const;
+
+        // Индексы имён строятся после добавления всех остановок и автобусов и хранятся в базе.
+        // Загруженные до добавления остановок и автобусов, они избавляют от заполнения хеш-таблиц имён.
+        void BuildNameIndices();
+        void SetNameIndices(PerfectHashIndex stopNameIndex, PerfectHashIndex busNameIndex);
+        const PerfectHashIndex& GetStopNameIndex() const;
+        const PerfectHashIndex& GetBusNameIndex() const;
 
         double ComputeRouteDistance(const Bus& bus) const;
         double ComputeRealRouteDistance(const Bus& bus) const;
         double ComputeRealStopToStopDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const;
+        // Расстояния между остановками маршрута с индексами indexFrom <= indexTo за O(1)
+        double SegmentDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const;
+        double SegmentGeoDistance(const Bus& bus, size_t indexFrom, size_t indexTo) const;
 
         template<typename InputIt>
         double ComputeRealRouteDistance(InputIt from, InputIt to) const;
 
 
     private:
-
+        // Расстояние по дорогам, а если оно не задано - переданное расстояние по прямой
+        double ComputeRealNeighbourDistance(const Stop* stopFrom, const Stop* stopTo, double geoDistance) const;
+        void ComputeBusDistances(Bus& bus) const;
+        BusStat ComputeBusStat(const Bus& bus) const;
+        bool AreStatTablesBuilt() const;
+        void ClearStatTables();
 
         std::deque<Stop> stops_;
-        std::unordered_map<std::string_view, const Stop&, std::hash<std::string_view>> stopByName_;
-
         std::deque<Bus> buses_;
+
+        // Остановки и автобусы, не покрытые индексами имён, ищутся через хеш-таблицы
+        PerfectHashIndex stopNameIndex_;
+        PerfectHashIndex busNameIndex_;
+        std::unordered_map<std::string_view, const Stop&, std::hash<std::string_view>> stopByName_;
         std::unordered_map<std::string_view, const Bus&, std::hash<std::string_view>> busByName_;
 
-        std::unordered_map<std::string_view, std::set<std::string_view>, std::hash<std::string_view>> busesByStopName;
+        // Ответы на запросы Bus по номеру автобуса
+        std::vector<BusStat> busStats_;
+        // Номера автобусов через остановку i лежат в stopBusIds_ с stopBusOffsets_[i] по stopBusOffsets_[i + 1]
+        std::vector<uint32_t> stopBusIds_;
+        std::vector<uint32_t> stopBusOffsets_;
+
+        FlatDistanceTable stopDistances_;
 
-        std::unordered_map<std::pair<const Stop*, const Stop*>, int, transport_catalogue::PairOfPointerHasher> stopDistances_;
+        geo::CoordinatesTable stopCoordinates_;
+        geo::DistanceMode geoDistanceMode_ = geo::DistanceMode::Exact;
     };
 
     namespace tests {
@@ -1,84 +1,561 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
 
 
 namespace transport_router {
 
     const double TO_DISTANCE_IN_MINUTE = 60/1000;
 
-    TransportRouter::TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, const Graph& graph)
-        : db_(&db), routingSetting_(routingSetting) {
-        graph_ = graph;
-        router_ = std::make_unique<Router>(graph_.value());
-        FillGraphWithStops(db_.value()->GetAllStops(), true);
-        FillGraphWithBuses(db_.value()->GetAllBuses(), true);
+    TransportRouter::TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, CompactGraphPtr graph,
+                                     std::unique_ptr<RouterBase> router,
+                                     std::optional<ConnectionScanRouter> connectionScanRouter)
+        : graph_(std::move(graph)), routingSetting_(routingSetting),
+          connectionScanRouter_(std::move(connectionScanRouter)), db_(&db) {
+        if(routingSetting_.value().routerType != RouterType::Raptor) {
+            FillGraphWithStops(db_.value()->GetAllStops());
+            if(routingSetting_.value().graphModel == GraphModel::Linear) {
+                FillGraphWithBusSegments(db_.value()->GetBuses());
+            } else {
+                FillGraphWithBuses(db_.value()->GetBuses());
+            }
+        }
+        ResetRaptor();
+        if(!connectionScanRouter_) {
+            ResetConnectionScanRouter();
+        }
+        if(router) {
+            router_ = std::move(router);
+        } else {
+            BuildRouter();
+        }
+        ResetRouteCache();
     }
 
-    TransportRouter::TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting)
+    TransportRouter::TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, size_t threadCount)
         : db_(&db), routingSetting_(routingSetting) {
-        graph_ = Graph(db_.value()->GetAllStops().size() * 2);
-        router_ = std::make_unique<Router>(graph_.value());
-        FillGraphWithStops(db_.value()->GetAllStops());
-        FillGraphWithBuses(db_.value()->GetAllBuses());
+        graph_ = BuildGraph();
+        ResetRaptor();
+        ResetConnectionScanRouter();
+        BuildRouter(threadCount);
+        ResetRouteCache();
+    }
+
+    std::optional<size_t> TransportRouter::UpdateEdgeWeights(size_t threadCount) {
+        edgeSteps_.clear();
+        edgeComponents_.clear();
+        onBoardStops_.clear();
+        graph_ = BuildGraph();
+        ResetRaptor();
+        ResetConnectionScanRouter();
+        // Рёбра графа те же, поменялись только веса, поэтому таблица и оверлей чинятся на месте,
+        // а иерархия и метки строятся заново
+        std::optional<size_t> recomputedRowCount;
+        switch (routingSetting_.value().routerType) {
+            case RouterType::FloydWarshall: {
+                auto router = std::make_unique<Router>(graph_, static_cast<const Router&>(*router_), threadCount);
+                recomputedRowCount = router->GetRecomputedRowCount();
+                router_ = std::move(router);
+                break;
+            }
+            case RouterType::PartitionOverlay:
+                router_ = std::make_unique<PartitionOverlay>(graph_, static_cast<const PartitionOverlay&>(*router_), threadCount);
+                break;
+            default:
+                BuildRouter(threadCount);
+                break;
+        }
+        // Маршруты в кэше посчитаны по старым весам
+        ResetRouteCache();
+        return recomputedRowCount;
+    }
+
+    void TransportRouter::ResetRaptor() {
+        std::lock_guard guard(*raptorMutex_);
+        raptor_.reset();
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            raptor_.emplace(*db_.value(), routingSetting_.value().busWaitTime, routingSetting_.value().busVelocity);
+        }
+    }
+
+    void TransportRouter::ResetConnectionScanRouter() {
+        connectionScanRouter_.reset();
+        const auto& buses = db_.value()->GetBuses();
+        if(std::any_of(buses.begin(), buses.end(), [](const Bus& bus) { return !bus.departures_.empty(); })) {
+            connectionScanRouter_.emplace(*db_.value(), routingSetting_.value().busVelocity);
+        }
+    }
+
+    const RaptorRouter& TransportRouter::GetRaptor() const {
+        std::lock_guard guard(*raptorMutex_);
+        if(!raptor_) {
+            raptor_.emplace(*db_.value(), routingSetting_.value().busWaitTime, routingSetting_.value().busVelocity);
+        }
+        return *raptor_;
+    }
+
+    void TransportRouter::ResetRouteCache() {
+        if(routingSetting_.value().routeCacheSize > 0) {
+            routeCache_ = std::make_unique<RouteCache>(routingSetting_.value().routeCacheSize);
+        } else {
+            routeCache_.reset();
+        }
+    }
+
+    RouteCacheStatistics TransportRouter::GetRouteCacheStatistics() const {
+        return routeCache_ ? routeCache_->GetStatistics() : RouteCacheStatistics{0, 0, 0};
     }
 
+    std::optional<HubLabels::LabelStatistics> TransportRouter::GetHubLabelStatistics() const {
+        if(routingSetting_.value().routerType != RouterType::HubLabels || !router_) {
+            return std::nullopt;
+        }
+        return static_cast<const HubLabels&>(*router_).GetStatistics();
+    }
 
-    void TransportRouter::FillGraphWithStops(const std::deque<Stop>& stops, bool isGraphDeserialized) {
-        size_t vertexId = 0;
+    RouteCache::RouteCache(size_t capacity)
+        : capacity_(capacity) {
+    }
+
+    RouteCache::CachedRoute RouteCache::Find(const Key& key) {
+        std::lock_guard guard(mutex_);
+        auto it = routes_.find(key);
+        if(it == routes_.end()) {
+            ++misses_;
+            return nullptr;
+        }
+        ++hits_;
+        recentlyUsed_.splice(recentlyUsed_.begin(), recentlyUsed_, it->second.second);
+        return it->second.first;
+    }
+
+    void RouteCache::Insert(const Key& key, CachedRoute route) {
+        std::lock_guard guard(mutex_);
+        // Тот же маршрут мог успеть посчитать другой поток
+        if(routes_.count(key)) {
+            return;
+        }
+        while(routes_.size() >= capacity_) {
+            routes_.erase(recentlyUsed_.back());
+            recentlyUsed_.pop_back();
+        }
+        recentlyUsed_.push_front(key);
+        routes_.emplace(key, std::make_pair(std::move(route), recentlyUsed_.begin()));
+    }
+
+    RouteCacheStatistics RouteCache::GetStatistics() const {
+        std::lock_guard guard(mutex_);
+        return {hits_, misses_, routes_.size()};
+    }
+
+    CompactGraphPtr TransportRouter::BuildGraph() {
+        Graph graph(ComputeVertexCount());
+        // RAPTOR работает прямо по маршрутам автобусов, граф для него не нужен
+        if(routingSetting_.value().routerType != RouterType::Raptor) {
+            FillGraphWithStops(db_.value()->GetAllStops(), &graph);
+            if(routingSetting_.value().graphModel == GraphModel::Linear) {
+                FillGraphWithBusSegments(db_.value()->GetBuses(), &graph);
+            } else {
+                FillGraphWithBuses(db_.value()->GetBuses(), &graph);
+            }
+        }
+        return std::make_shared<const CompactGraph>(graph);
+    }
+
+    void TransportRouter::BuildRouter(size_t threadCount) {
+        switch (routingSetting_.value().routerType) {
+            case RouterType::FloydWarshall:
+                router_ = std::make_unique<Router>(graph_, threadCount);
+                break;
+            case RouterType::Dijkstra:
+                router_ = std::make_unique<DijkstraRouter>(graph_, routingSetting_.value().dijkstraCacheSize);
+                break;
+            case RouterType::ContractionHierarchy:
+                router_ = std::make_unique<ContractionHierarchy>(graph_);
+                break;
+            case RouterType::HubLabels:
+                router_ = std::make_unique<HubLabels>(graph_);
+                break;
+            case RouterType::PartitionOverlay:
+                router_ = std::make_unique<PartitionOverlay>(graph_, ComputeStopCells(), threadCount);
+                break;
+            case RouterType::Raptor:
+                router_.reset();
+                break;
+        }
+    }
+
+    // Рекурсивно делит остановки пополам по медиане вдоль более протяжённой координаты,
+    // пока в части не останется не больше cellSize остановок. Обе вершины остановки попадают в одну ячейку.
+    std::vector<PartitionOverlay::CellId> TransportRouter::ComputeStopCells() const {
+        const std::deque<Stop>& stops = db_.value()->GetAllStops();
+        const size_t cellSize = std::max<size_t>(1, routingSetting_.value().cellSize);
+        std::vector<const Stop*> order;
+        order.reserve(stops.size());
         for(const auto& stop : stops) {
-            size_t edgeId = edgeIds_.size();
-            if(!isGraphDeserialized) {
-                edgeId = graph_.value().AddEdge({vertexId, vertexId + 1, routingSetting_.value().busWaitTime});
+            order.push_back(&stop);
+        }
+
+        std::vector<PartitionOverlay::CellId> cells(graph_->GetVertexCount(), 0);
+        PartitionOverlay::CellId nextCell = 0;
+        std::vector<std::pair<size_t, size_t>> parts{{0, order.size()}};
+        while(!parts.empty()) {
+            const auto [begin, end] = parts.back();
+            parts.pop_back();
+            if(end - begin <= cellSize) {
+                for(size_t i = begin; i < end; ++i) {
+                    const size_t vertexId = GetStopVertexId(order[i]);
+                    cells[vertexId] = nextCell;
+                    cells[vertexId + 1] = nextCell;
+                }
+                ++nextCell;
+                continue;
             }
-            edgeIds_[edgeId] = std::make_shared<OnWait>(routingSetting_.value().busWaitTime, &stop);
-            vertexIds_[&stop] = vertexId;
-            vertexId += 2;
+            const auto [minLat, maxLat] = std::minmax_element(order.begin() + begin, order.begin() + end, [](const Stop* lhs, const Stop* rhs) {
+                return lhs->coordinates_.lat < rhs->coordinates_.lat;
+            });
+            const auto [minLng, maxLng] = std::minmax_element(order.begin() + begin, order.begin() + end, [](const Stop* lhs, const Stop* rhs) {
+                return lhs->coordinates_.lng < rhs->coordinates_.lng;
+            });
+            const bool byLatitude = (*maxLat)->coordinates_.lat - (*minLat)->coordinates_.lat >=
+                                    (*maxLng)->coordinates_.lng - (*minLng)->coordinates_.lng;
+            const size_t middle = begin + (end - begin) / 2;
+            std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [byLatitude](const Stop* lhs, const Stop* rhs) {
+                return byLatitude ? lhs->coordinates_.lat < rhs->coordinates_.lat : lhs->coordinates_.lng < rhs->coordinates_.lng;
+            });
+            parts.push_back({middle, end});
+            parts.push_back({begin, middle});
+        }
+        // Вершины "в салоне" попадают в ячейку своей остановки
+        for(size_t i = 0; i < onBoardStops_.size(); ++i) {
+            cells[stops.size() * 2 + i] = cells[GetStopVertexId(onBoardStops_[i])];
         }
+        return cells;
     }
 
-    void TransportRouter::FillGraphWithBuses(const BusesContaner& buses, bool isGraphDeserialized) {
-        for(const auto& [name, bus] : buses) {
+
+    void TransportRouter::FillGraphWithStops(const std::deque<Stop>& stops, Graph* graph) {
+        for(const auto& stop : stops) {
+            const size_t vertexId = GetStopVertexId(&stop);
+            if(graph) {
+                graph->AddEdge({vertexId, vertexId + 1, routingSetting_.value().busWaitTime});
+            }
+            edgeSteps_.push_back(RouteStep::OnWait(routingSetting_.value().busWaitTime, stop.id_));
+            edgeComponents_.push_back({1, 0.});
+        }
+    }
+
+    void TransportRouter::FillGraphWithBuses(const BusesContaner& buses, Graph* graph) {
+        for(const Bus& bus : buses) {
             for(size_t i = 0; i < bus.route_.size(); ++i) {
-                size_t vertexId1 = vertexIds_[bus.route_[i]];
+                size_t vertexId1 = GetStopVertexId(bus.route_[i]);
                 for(size_t j = i + 1; j < bus.route_.size(); ++j) {
-                    auto edgeDistance = ComputeTimeInMinute(db_.value()->ComputeRealStopToStopDistance(bus, i, j), routingSetting_.value().busVelocity);
-                    size_t vertexId2 = vertexIds_[bus.route_[j]];
-                    size_t edgeId = edgeIds_.size();
-                    if(!isGraphDeserialized) {
-                        edgeId = graph_.value().AddEdge({vertexId1 + 1, vertexId2, edgeDistance});
+                    const double distance = db_.value()->SegmentDistance(bus, i, j);
+                    auto edgeDistance = ComputeTimeInMinute(distance, routingSetting_.value().busVelocity);
+                    size_t vertexId2 = GetStopVertexId(bus.route_[j]);
+                    if(graph) {
+                        graph->AddEdge({vertexId1 + 1, vertexId2, edgeDistance});
                     }
-                    int spanCount = static_cast<int>(j) - static_cast<int>(i);
-                    edgeIds_[edgeId] = std::make_shared<OnBus>(edgeDistance, &bus, spanCount );
+                    edgeSteps_.push_back(RouteStep::OnBus(edgeDistance, bus.id_, static_cast<uint32_t>(j - i)));
+                    edgeComponents_.push_back({0, distance});
+                }
+            }
+        }
+    }
+
+    // Посадка ведёт из вершины отправления остановки в вершину "в салоне", перегоны соединяют вершины
+    // "в салоне" соседних остановок маршрута, высадка ведёт обратно в вершину прибытия остановки
+    void TransportRouter::FillGraphWithBusSegments(const BusesContaner& buses, Graph* graph) {
+        auto addEdge = [this, graph](size_t from, size_t to, uint32_t busId, RouteStepType type, double distance) {
+            const double weight = ComputeTimeInMinute(distance, routingSetting_.value().busVelocity);
+            if(graph) {
+                graph->AddEdge({from, to, weight});
+            }
+            edgeSteps_.push_back(RouteStep::OnBus(weight, busId, type == RouteStepType::Ride ? 1 : 0, type));
+            edgeComponents_.push_back({0, distance});
+        };
+        size_t onBoardVertexId = db_.value()->GetAllStops().size() * 2;
+        for(const Bus& bus : buses) {
+            for(size_t i = 0; i < bus.route_.size(); ++i) {
+                const size_t stopVertexId = GetStopVertexId(bus.route_[i]);
+                onBoardStops_.push_back(bus.route_[i]);
+                if(i + 1 < bus.route_.size()) {
+                    addEdge(stopVertexId + 1, onBoardVertexId, bus.id_, RouteStepType::Board, 0.);
+                    addEdge(onBoardVertexId, onBoardVertexId + 1, bus.id_, RouteStepType::Ride, db_.value()->SegmentDistance(bus, i, i + 1));
                 }
+                if(i > 0) {
+                    addEdge(onBoardVertexId, stopVertexId, bus.id_, RouteStepType::Alight, 0.);
+                }
+                ++onBoardVertexId;
             }
         }
     }
 
-    std::optional<RouteInfo> TransportRouter::GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo) const {
-        size_t idFrom = vertexIds_.at(&db_.value()->GetStop(routeFrom));
-        size_t idTo = vertexIds_.at(&db_.value()->GetStop(routeTo));
+    size_t TransportRouter::ComputeVertexCount() const {
+        size_t vertexCount = db_.value()->GetAllStops().size() * 2;
+        if(routingSetting_.value().graphModel == GraphModel::Linear) {
+            for(const auto& bus : db_.value()->GetBuses()) {
+                vertexCount += bus.route_.size();
+            }
+        }
+        return vertexCount;
+    }
+
+    SharedRoute TransportRouter::GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo) const {
+        const Stop* stopFrom = &db_.value()->GetStop(routeFrom);
+        const Stop* stopTo = &db_.value()->GetStop(routeTo);
+        if(!routeCache_) {
+            return std::make_shared<const std::optional<RouteInfo>>(ComputeOptimalRoute(stopFrom, stopTo));
+        }
+        const RouteCache::Key key = static_cast<uint64_t>(stopFrom->id_) << 32 | stopTo->id_;
+        if(auto cachedRoute = routeCache_->Find(key)) {
+            return cachedRoute;
+        }
+        auto route = std::make_shared<const std::optional<RouteInfo>>(ComputeOptimalRoute(stopFrom, stopTo));
+        routeCache_->Insert(key, route);
+        return route;
+    }
+
+    std::optional<RouteInfo> TransportRouter::ComputeOptimalRoute(const Stop* stopFrom, const Stop* stopTo) const {
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            auto journey = GetRaptor().FindFastestJourney(stopFrom, stopTo);
+            if(!journey.has_value()) {
+                return {};
+            }
+            return ConvertJourney(journey.value(), routingSetting_.value().busWaitTime);
+        }
+        size_t idFrom = GetStopVertexId(stopFrom);
+        size_t idTo = GetStopVertexId(stopTo);
         auto graphRouteInfo = router_->BuildRoute(idFrom, idTo);
 
         if(graphRouteInfo.has_value()) {
-            transport_router::RouteInfo completeRouteInfo;
-            completeRouteInfo.totalTime = graphRouteInfo.value().weight;
-            for(auto edgeId : graphRouteInfo.value().edges) {
-                completeRouteInfo.routeSteps.push_back(edgeIds_.at(edgeId));
-            }
-            return completeRouteInfo;
+            return ConvertRoute(graphRouteInfo.value());
         }
         return {};
 
     }
 
-    const Graph& TransportRouter::GetGraph() const {
-        return graph_.value();
+    std::optional<RouteInfo> TransportRouter::GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo,
+                                                              const RoutingSetting& setting) const {
+        // С отрицательными весами поиск по графу может не закончиться на отрицательном цикле
+        if(setting.busWaitTime < 0. || setting.busVelocity <= 0.) {
+            throw std::invalid_argument("Bus wait time must be non-negative and bus velocity positive");
+        }
+        const Stop* stopFrom = &db_.value()->GetStop(routeFrom);
+        const Stop* stopTo = &db_.value()->GetStop(routeTo);
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            auto journey = GetRaptor().FindFastestJourney(stopFrom, stopTo,
+                                                          RaptorRouter::TravelSetting{setting.busWaitTime, setting.busVelocity});
+            if(!journey.has_value()) {
+                return {};
+            }
+            return ConvertJourney(journey.value(), setting.busWaitTime);
+        }
+        // Предпосчитанные данные движка построены для весов по умолчанию, поэтому здесь отдельный поиск по графу
+        auto graphRouteInfo = graph::FindShortestPath(*graph_, GetStopVertexId(stopFrom), GetStopVertexId(stopTo), [&](graph::EdgeId edgeId) {
+            return ComputeEdgeTime(edgeId, setting);
+        });
+        if(!graphRouteInfo.has_value()) {
+            return {};
+        }
+        return ConvertRoute(graphRouteInfo.value(), setting);
+    }
+
+    std::vector<RouteInfo> TransportRouter::GetAlternativeRoutes(const std::string& routeFrom, const std::string& routeTo,
+                                                                 size_t count, size_t threadCount) const {
+        count = std::min(count, MAX_ROUTE_ALTERNATIVES);
+        std::vector<RouteInfo> routes;
+        // Без графа альтернативы искать не в чем, остаётся только лучший маршрут
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            if(auto route = GetOptimalRoute(routeFrom, routeTo); route->has_value() && count > 0) {
+                routes.push_back(route->value());
+            }
+            return routes;
+        }
+        size_t idFrom = GetStopVertexId(&db_.value()->GetStop(routeFrom));
+        size_t idTo = GetStopVertexId(&db_.value()->GetStop(routeTo));
+        // В полной модели одна поездка может быть двумя рёбрами, например, когда некольцевой автобус
+        // проходит одну и ту же пару остановок в прямом и обратном направлении. Каждый путь переводится
+        // в маршрут один раз и сравнивается с уже принятыми маршрутами
+        auto isNewItinerary = [this, &routes](const RouterBase::RouteInfo& graphRouteInfo) {
+            RouteInfo route = ConvertRoute(graphRouteInfo);
+            if(std::any_of(routes.begin(), routes.end(), [&route](const RouteInfo& accepted) {
+                    return IsSameItinerary(accepted, route);
+                })) {
+                return false;
+            }
+            routes.push_back(std::move(route));
+            return true;
+        };
+        KShortestPaths(graph_).FindPaths(*router_, idFrom, idTo, count, threadCount, isNewItinerary);
+        return routes;
+    }
+
+    RouteInfo TransportRouter::ConvertRoute(const RouterBase::RouteInfo& graphRouteInfo,
+                                            const std::optional<RoutingSetting>& customSetting) const {
+        transport_router::RouteInfo completeRouteInfo;
+        completeRouteInfo.totalTime = graphRouteInfo.weight;
+        completeRouteInfo.routeSteps.reserve(graphRouteInfo.edges.size());
+        // В линейной модели поездка - цепочка посадка, перегоны, высадка, в ответе она одним шагом
+        double rideTime = 0.;
+        uint32_t spanCount = 0;
+        for(auto edgeId : graphRouteInfo.edges) {
+            const RouteStep& edgeStep = edgeSteps_[edgeId];
+            const double time = customSetting.has_value() ? ComputeEdgeTime(edgeId, customSetting.value()) : edgeStep.time;
+            switch (edgeStep.type) {
+                case RouteStepType::Wait:
+                case RouteStepType::Bus:
+                    completeRouteInfo.routeSteps.push_back(edgeStep);
+                    completeRouteInfo.routeSteps.back().time = time;
+                    break;
+                case RouteStepType::Board:
+                    rideTime = 0.;
+                    spanCount = 0;
+                    break;
+                case RouteStepType::Ride:
+                    rideTime += time;
+                    ++spanCount;
+                    break;
+                case RouteStepType::Alight:
+                    completeRouteInfo.routeSteps.push_back(RouteStep::OnBus(rideTime, edgeStep.id, spanCount));
+                    break;
+            }
+        }
+        return completeRouteInfo;
+    }
+
+    std::vector<ParetoRouteInfo> TransportRouter::GetParetoRoutes(const std::string& routeFrom, const std::string& routeTo) const {
+        std::vector<ParetoRouteInfo> routes;
+        for(const auto& journey : GetRaptor().FindParetoJourneys(&db_.value()->GetStop(routeFrom), &db_.value()->GetStop(routeTo))) {
+            routes.push_back({journey.transfers, ConvertJourney(journey, routingSetting_.value().busWaitTime)});
+        }
+        return routes;
+    }
+
+    std::optional<RouteInfo> TransportRouter::GetEarliestArrivalRoute(const std::string& routeFrom, const std::string& routeTo,
+                                                                      double departureTime) const {
+        if(!connectionScanRouter_) {
+            throw std::logic_error("There is no timetable in the base");
+        }
+        auto journey = connectionScanRouter_.value().FindEarliestArrival(&db_.value()->GetStop(routeFrom),
+                                                                         &db_.value()->GetStop(routeTo), departureTime);
+        if(!journey.has_value()) {
+            return {};
+        }
+        RouteInfo routeInfo;
+        routeInfo.totalTime = journey.value().totalTime;
+        for(const auto& leg : journey.value().legs) {
+            routeInfo.routeSteps.push_back(RouteStep::OnWait(leg.waitTime, leg.boardStop));
+            routeInfo.routeSteps.push_back(RouteStep::OnBus(leg.rideTime, leg.bus, static_cast<uint32_t>(leg.spanCount)));
+        }
+        return routeInfo;
+    }
+
+    RouteMatrix TransportRouter::GetRouteMatrix(const std::vector<std::string>& routesFrom, const std::vector<std::string>& routesTo,
+                                                size_t threadCount) const {
+        std::vector<const Stop*> stopsFrom;
+        for(const auto& name : routesFrom) {
+            stopsFrom.push_back(&db_.value()->GetStop(name));
+        }
+        std::vector<const Stop*> stopsTo;
+        for(const auto& name : routesTo) {
+            stopsTo.push_back(&db_.value()->GetStop(name));
+        }
+
+        RouteMatrix matrix(stopsFrom.size());
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            // Один проход раундов без цели на строку матрицы
+            const RaptorRouter& raptor = GetRaptor();
+            parallel::ParallelFor(stopsFrom.size(), threadCount, [&](size_t i) {
+                const std::vector<double> arrivals = raptor.FindArrivalTimes(stopsFrom[i], std::numeric_limits<double>::infinity());
+                for(const Stop* stopTo : stopsTo) {
+                    const double arrival = arrivals[stopTo->id_];
+                    matrix[i].push_back(std::isinf(arrival) ? std::nullopt : std::optional<double>(arrival));
+                }
+            }, 1);
+            return matrix;
+        }
+
+        std::vector<graph::VertexId> targets;
+        for(const Stop* stopTo : stopsTo) {
+            targets.push_back(GetStopVertexId(stopTo));
+        }
+        parallel::ParallelFor(stopsFrom.size(), threadCount, [&](size_t i) {
+            matrix[i] = router_->GetRouteWeights(GetStopVertexId(stopsFrom[i]), targets);
+        }, 1);
+        return matrix;
+    }
+
+    std::vector<ReachableStop> TransportRouter::GetReachableStops(const std::string& stopName, double timeBudget) const {
+        const std::deque<Stop>& stops = db_.value()->GetAllStops();
+        const Stop& stopFrom = db_.value()->GetStop(stopName);
+        std::vector<ReachableStop> reachableStops;
+        if(routingSetting_.value().routerType == RouterType::Raptor) {
+            const std::vector<double> arrivals = GetRaptor().FindArrivalTimes(&stopFrom, timeBudget);
+            for(size_t i = 0; i < stops.size(); ++i) {
+                if(arrivals[i] <= timeBudget) {
+                    reachableStops.push_back({&stops[i], arrivals[i]});
+                }
+            }
+            std::stable_sort(reachableStops.begin(), reachableStops.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+                return lhs.totalTime < rhs.totalTime;
+            });
+            return reachableStops;
+        }
+
+        // Вершина прибытия остановки i - 2 * i, остальные вершины (отправления и "в салоне") пропускаются
+        for(const auto& [vertexId, weight] : graph::ComputeReachableVertices(*graph_, GetStopVertexId(&stopFrom), timeBudget)) {
+            if(vertexId < stops.size() * 2 && vertexId % 2 == 0) {
+                reachableStops.push_back({&stops[vertexId / 2], weight});
+            }
+        }
+        return reachableStops;
+    }
+
+    RouteInfo TransportRouter::ConvertJourney(const RaptorRouter::Journey& journey, double busWaitTime) const {
+        RouteInfo routeInfo;
+        routeInfo.totalTime = journey.totalTime;
+        for(const auto& leg : journey.legs) {
+            routeInfo.routeSteps.push_back(RouteStep::OnWait(busWaitTime, leg.boardStop));
+            routeInfo.routeSteps.push_back(RouteStep::OnBus(leg.rideTime, leg.bus, static_cast<uint32_t>(leg.spanCount)));
+        }
+        return routeInfo;
+    }
+
+    const CompactGraph& TransportRouter::GetGraph() const {
+        return *graph_;
     }
 
     const RoutingSetting& TransportRouter::GetRoutingSetting() const {
         return routingSetting_.value();
     }
 
+    const RouterBase& TransportRouter::GetRouter() const {
+        return *router_;
+    }
+
+    bool TransportRouter::HasTimetable() const {
+        return connectionScanRouter_.has_value();
+    }
+
+    const ConnectionScanRouter& TransportRouter::GetConnectionScanRouter() const {
+        return connectionScanRouter_.value();
+    }
+
+    // Вершины остановки с номером i - 2 * i (прибытие) и 2 * i + 1 (отправление)
+    size_t TransportRouter::GetStopVertexId(const Stop* stop) {
+        return static_cast<size_t>(stop->id_) * 2;
+    }
+
+    double TransportRouter::ComputeEdgeTime(graph::EdgeId edgeId, const RoutingSetting& setting) const {
+        const EdgeComponents& components = edgeComponents_[edgeId];
+        return components.waitCount * setting.busWaitTime + ComputeTimeInMinute(components.distance, setting.busVelocity);
+    }
+
     double TransportRouter::ComputeTimeInMinute (double sInMeters, double vInKmh) const {
         double sInKm = sInMeters / 1000;
         double tInH = sInKm / vInKmh;
@@ -87,31 +564,217 @@ namespace transport_router {
 
 
 
-    Activity::Activity(double time) : time_(time) {
+    RouteStep RouteStep::OnWait(double time, uint32_t stopId) {
+        return {RouteStepType::Wait, 0, time, stopId};
     }
-    void Activity::WriteInJsonDict(json::Dict& dict) {
-        using namespace std::literals;
-        dict.insert({"time"s, json::Builder{}.Value(time_).Build()});
+
+    RouteStep RouteStep::OnBus(double time, uint32_t busId, uint32_t spanCount, RouteStepType type) {
+        return {type, spanCount, time, busId};
     }
 
-    OnWait::OnWait(double time, const Stop* stop) : Activity(time), stop_(stop){
+    bool IsSameItinerary(const RouteInfo& lhs, const RouteInfo& rhs) {
+        return std::equal(lhs.routeSteps.begin(), lhs.routeSteps.end(), rhs.routeSteps.begin(), rhs.routeSteps.end(),
+                          [](const RouteStep& lhsStep, const RouteStep& rhsStep) {
+            return lhsStep.type == rhsStep.type && lhsStep.id == rhsStep.id && lhsStep.spanCount == rhsStep.spanCount;
+        });
     }
-    void OnWait::WriteInJsonDict(json::Dict& dict) {
+
+    void WriteInJsonDict(const RouteStep& routeStep, const TransportCatalogue& db, json::Dict& dict) {
         using namespace std::literals;
+        dict.insert({"time"s, json::Builder{}.Value(routeStep.time).Build()});
+        if(routeStep.type == RouteStepType::Wait) {
+            dict.insert({"type"s, json::Builder{}.Value("Wait"s).Build()});
+            dict.insert({"stop_name"s, json::Builder{}.Value(std::string(db.GetAllStops()[routeStep.id].name_)).Build()});
+        } else {
+            dict.insert({"type"s, json::Builder{}.Value("Bus"s).Build()});
+            dict.insert({"bus"s, json::Builder{}.Value(std::string(db.GetBuses()[routeStep.id].name_)).Build()});
+            dict.insert({"span_count"s, json::Builder{}.Value(static_cast<int>(routeStep.spanCount)).Build()});
+        }
+    }
+
+    // Некольцевой автобус A - B - A проезжает A -> B дважды, в полной модели это два одинаковых ребра.
+    // Вторая альтернатива не должна повторять первую
+    void tests::AlternativeRoutesAreDistinct() {
+        using namespace std::literals;
+        TransportCatalogue catalogue;
+        catalogue.AddStop({"A"s, {55.60, 37.60}});
+        catalogue.AddStop({"B"s, {55.61, 37.61}});
+        catalogue.SetStopsDistance(&catalogue.GetStop("A"s), &catalogue.GetStop("B"s), 1000);
+        // Маршрут A-B-A-B: рёбра A-B из первой и третьей остановки параллельны
+        const Stop* a = &catalogue.GetStop("A"s);
+        const Stop* b = &catalogue.GetStop("B"s);
+        catalogue.AddBus({"1"s, {a, b, a, b}, true});
 
-        transport_router::Activity::WriteInJsonDict(dict);
-        dict.insert({"type"s, json::Builder{}.Value("Wait"s).Build()});
-        dict.insert({"stop_name"s, json::Builder{}.Value(std::string(stop_->name_)).Build()});
+        RoutingSetting setting{6, 40};
+        setting.routeCacheSize = 0;
+        TransportRouter router(catalogue, setting);
+        const std::vector<RouteInfo> routes = router.GetAlternativeRoutes("A"s, "B"s, 2);
+        assert(routes.size() == 2);
+        assert(!IsSameItinerary(routes[0], routes[1]));
+        assert(routes[0].routeSteps[1].spanCount == 1);
+        assert(routes[1].routeSteps[1].spanCount == 3);
+
+        // Автобус 1 доезжает из A в X через P (200 м) или через R (300 м), для пользователя это один маршрут.
+        // Отклонённый путь через R не должен вытеснить из кандидатов более быстрый маршрут через P и T,
+        // поэтому второй маршрут не зависит от того, сколько альтернатив запрошено
+        TransportCatalogue ringCatalogue;
+        const std::vector<std::string> names{"A"s, "P"s, "X"s, "Q"s, "R"s, "S"s, "B"s, "T"s};
+        for(size_t i = 0; i < names.size(); ++i) {
+            ringCatalogue.AddStop({names[i], {55.60 + 0.01 * i, 37.60}});
+        }
+        auto stop = [&ringCatalogue](const std::string& name) { return &ringCatalogue.GetStop(name); };
+        for(const auto& [from, to, distance] : std::vector<std::tuple<std::string, std::string, int>>{
+                {"A"s, "P"s, 100}, {"P"s, "X"s, 100}, {"X"s, "Q"s, 1000}, {"Q"s, "A"s, 1000},
+                {"A"s, "R"s, 150}, {"R"s, "X"s, 150}, {"X"s, "S"s, 1000}, {"S"s, "A"s, 1000},
+                {"X"s, "B"s, 1000}, {"X"s, "T"s, 500}, {"T"s, "B"s, 650}}) {
+            ringCatalogue.SetStopsDistance(stop(from), stop(to), distance);
+        }
+        ringCatalogue.AddBus({"1"s, {stop("A"s), stop("P"s), stop("X"s), stop("Q"s), stop("A"s),
+                                     stop("R"s), stop("X"s), stop("S"s), stop("A"s)}, true});
+        ringCatalogue.AddBus({"2"s, {stop("X"s), stop("B"s), stop("X"s)}, false});
+        ringCatalogue.AddBus({"3"s, {stop("X"s), stop("T"s), stop("B"s), stop("T"s), stop("X"s)}, false});
+
+        RoutingSetting ringSetting{1, 60};
+        ringSetting.routeCacheSize = 0;
+        const TransportRouter ringRouter(ringCatalogue, ringSetting);
+        const std::vector<RouteInfo> twoRoutes = ringRouter.GetAlternativeRoutes("A"s, "B"s, 2);
+        const std::vector<RouteInfo> threeRoutes = ringRouter.GetAlternativeRoutes("A"s, "B"s, 3);
+        assert(twoRoutes.size() == 2 && threeRoutes.size() >= 2);
+        assert(std::abs(twoRoutes[0].totalTime - 3.2) < 1e-9);
+        assert(std::abs(twoRoutes[1].totalTime - 3.35) < 1e-9);
+        assert(std::abs(twoRoutes[1].totalTime - threeRoutes[1].totalTime) < 1e-9);
+        assert(IsSameItinerary(twoRoutes[1], threeRoutes[1]));
     }
 
-    OnBus::OnBus(double time, const Bus* bus, int spanCount) : Activity(time), bus_(bus), spanCount_(spanCount){
+    namespace {
+
+        // Шесть остановок, три кольцевых автобуса с пересадками и разными расстояниями туда и обратно
+        std::vector<std::string> FillTestCatalogue(TransportCatalogue& catalogue) {
+            using namespace std::literals;
+            const std::vector<std::string> names{"A"s, "B"s, "C"s, "D"s, "E"s, "F"s};
+            for(size_t i = 0; i < names.size(); ++i) {
+                catalogue.AddStop({names[i], {55.60 + 0.01 * i, 37.60 + 0.02 * (i % 3)}});
+            }
+            auto stop = [&catalogue](const std::string& name) { return &catalogue.GetStop(name); };
+            auto setDistances = [&catalogue](const Stop* from, const Stop* to, int forward, int backward) {
+                catalogue.SetStopsDistance(from, to, forward);
+                catalogue.SetStopsDistance(to, from, backward);
+            };
+            setDistances(stop("A"s), stop("B"s), 1200, 1500);
+            setDistances(stop("B"s), stop("C"s), 800, 900);
+            setDistances(stop("C"s), stop("A"s), 2500, 2000);
+            setDistances(stop("B"s), stop("D"s), 3000, 2700);
+            setDistances(stop("D"s), stop("E"s), 600, 650);
+            setDistances(stop("E"s), stop("B"s), 4100, 3900);
+            setDistances(stop("C"s), stop("F"s), 1700, 1800);
+            setDistances(stop("F"s), stop("D"s), 2200, 2100);
+            catalogue.AddBus({"1"s, {stop("A"s), stop("B"s), stop("C"s), stop("A"s)}, true});
+            catalogue.AddBus({"2"s, {stop("B"s), stop("D"s), stop("E"s), stop("B"s)}, true});
+            catalogue.AddBus({"3"s, {stop("C"s), stop("F"s), stop("D"s), stop("F"s), stop("C"s)}, true});
+            return names;
+        }
+
+        bool IsSameMatrix(const RouteMatrix& lhs, const RouteMatrix& rhs, double tolerance) {
+            if(lhs.size() != rhs.size()) {
+                return false;
+            }
+            for(size_t i = 0; i < lhs.size(); ++i) {
+                if(lhs[i].size() != rhs[i].size()) {
+                    return false;
+                }
+                for(size_t j = 0; j < lhs[i].size(); ++j) {
+                    if(lhs[i][j].has_value() != rhs[i][j].has_value()
+                       || (lhs[i][j] && std::abs(*lhs[i][j] - *rhs[i][j]) > tolerance)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    }
+
+    // Все движки на обеих моделях графа находят то же время в пути, что и таблица Флойда-Уоршелла
+    void tests::EnginesMatchFloydWarshall() {
+        TransportCatalogue catalogue;
+        const std::vector<std::string> names = FillTestCatalogue(catalogue);
+
+        RoutingSetting setting{6, 40};
+        setting.routeCacheSize = 0;
+        setting.cellSize = 2;
+        const RouteMatrix expected = TransportRouter(catalogue, setting).GetRouteMatrix(names, names);
+        for(const GraphModel graphModel : {GraphModel::Complete, GraphModel::Linear}) {
+            for(const RouterType routerType : {RouterType::FloydWarshall, RouterType::Dijkstra,
+                                               RouterType::ContractionHierarchy, RouterType::HubLabels,
+                                               RouterType::PartitionOverlay, RouterType::Raptor}) {
+                setting.graphModel = graphModel;
+                setting.routerType = routerType;
+                const TransportRouter router(catalogue, setting);
+                assert(IsSameMatrix(router.GetRouteMatrix(names, names), expected, 1e-9));
+                for(size_t i = 0; i < names.size(); ++i) {
+                    for(size_t j = 0; j < names.size(); ++j) {
+                        const SharedRoute route = router.GetOptimalRoute(names[i], names[j]);
+                        assert(route->has_value() == expected[i][j].has_value());
+                        assert(!route->has_value() || std::abs(route->value().totalTime - *expected[i][j]) <= 1e-9);
+                    }
+                }
+            }
+        }
     }
-    void OnBus::WriteInJsonDict(json::Dict& dict) {
+
+    // Таблица и оверлей, починенные после изменения расстояний, совпадают с построенными заново
+    void tests::UpdatedWeightsMatchRebuild() {
         using namespace std::literals;
-        transport_router::Activity::WriteInJsonDict(dict);
-        dict.insert({"type"s, json::Builder{}.Value("Bus"s).Build()});
-        dict.insert({"bus"s, json::Builder{}.Value(std::string(bus_->name_)).Build()});
-        dict.insert({"span_count"s, json::Builder{}.Value(spanCount_).Build()});
+        for(const RouterType routerType : {RouterType::FloydWarshall, RouterType::PartitionOverlay}) {
+            TransportCatalogue catalogue;
+            const std::vector<std::string> names = FillTestCatalogue(catalogue);
+
+            RoutingSetting setting{6, 40};
+            setting.routerType = routerType;
+            setting.routeCacheSize = 0;
+            setting.cellSize = 2;
+            TransportRouter router(catalogue, setting);
+            catalogue.SetStopsDistance(&catalogue.GetStop("B"s), &catalogue.GetStop("C"s), 5000);
+            catalogue.SetStopsDistance(&catalogue.GetStop("D"s), &catalogue.GetStop("E"s), 100);
+            const std::optional<size_t> recomputedRowCount = router.UpdateEdgeWeights(2);
+            assert(recomputedRowCount.has_value() == (routerType == RouterType::FloydWarshall));
+
+            const TransportRouter rebuiltRouter(catalogue, setting);
+            assert(IsSameMatrix(router.GetRouteMatrix(names, names), rebuiltRouter.GetRouteMatrix(names, names), 0.));
+        }
     }
-}
 
+    // Кэш вытесняет давно не использованный маршрут и считает попадания и промахи,
+    // а TransportRouter отдаёт повторный маршрут тем же указателем
+    void tests::RouteCacheEvictsLeastRecentlyUsed() {
+        using namespace std::literals;
+        RouteCache cache(2);
+        const auto route = [](double totalTime) {
+            return std::make_shared<const std::optional<RouteInfo>>(RouteInfo{totalTime, {}});
+        };
+        const SharedRoute first = route(1);
+        cache.Insert(1, first);
+        cache.Insert(2, route(2));
+        assert(cache.Find(1) == first);
+        // Маршрут 2 использовался давнее маршрута 1, он и вытесняется
+        cache.Insert(3, route(3));
+        assert(cache.Find(2) == nullptr);
+        assert(cache.Find(1) == first);
+        assert(cache.Find(3) != nullptr);
+        RouteCacheStatistics statistics = cache.GetStatistics();
+        assert(statistics.hits == 3 && statistics.misses == 1 && statistics.size == 2);
+
+        TransportCatalogue catalogue;
+        FillTestCatalogue(catalogue);
+        RoutingSetting setting{6, 40};
+        setting.routeCacheSize = 1;
+        TransportRouter router(catalogue, setting);
+        const SharedRoute route1 = router.GetOptimalRoute("A"s, "E"s);
+        assert(router.GetOptimalRoute("A"s, "E"s) == route1);
+        const SharedRoute route2 = router.GetOptimalRoute("E"s, "A"s);
+        assert(router.GetOptimalRoute("A"s, "E"s) != route1);
+        statistics = router.GetRouteCacheStatistics();
+        assert(statistics.hits == 1 && statistics.misses == 3 && statistics.size == 1);
+    }
+
+}
@@ -1,7 +1,16 @@
 #pragma once
 #include "transport_catalogue.h"
 #include "json_builder.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "partition_overlay.h"
+#include "k_shortest_paths.h"
+#include "raptor_router.h"
+#include "connection_scan_router.h"
+#include <list>
 #include <memory>
+#include <mutex>
 
 namespace transport_router {
 
@@ -9,84 +18,236 @@ namespace transport_router {
     using transport_catalogue::Bus;
     using transport_catalogue::TransportCatalogue;
     using Graph = graph::DirectedWeightedGraph<double>;
+    using CompactGraph = graph::CompactGraph<double>;
+    using CompactGraphPtr = graph::CompactGraphPtr<double>;
+    using RouterBase = graph::RouterBase<double>;
     using Router = graph::Router<double>;
-    using BusesContaner = std::unordered_map<std::basic_string_view<char>, const transport_catalogue::Bus &, std::hash<std::basic_string_view<char>>>;
+    using DijkstraRouter = graph::DijkstraRouter<double>;
+    using ContractionHierarchy = graph::ContractionHierarchy<double>;
+    using HubLabels = graph::HubLabels<double>;
+    using PartitionOverlay = graph::PartitionOverlay<double>;
+    using KShortestPaths = graph::KShortestPaths<double>;
+    using RouteTableView = graph::RouteTableView<double>;
+    using BusesContaner = std::deque<transport_catalogue::Bus>;
+
+
+    enum class RouterType {
+        FloydWarshall,
+        Dijkstra,
+        ContractionHierarchy,
+        HubLabels,
+        PartitionOverlay,
+        Raptor
+    };
+
+    // Complete - ребро на каждую пару остановок маршрута, O(n²) рёбер на автобус.
+    // Linear - у автобуса свои вершины "в салоне" на каждой остановке маршрута, рёбра только
+    // между соседними остановками плюс посадка и высадка, размер графа линеен по длине маршрутов.
+    enum class GraphModel {
+        Complete,
+        Linear
+    };
 
+    // Максимальное число остановок в ячейке разбиения для PartitionOverlay
+    constexpr size_t DEFAULT_CELL_SIZE = 128;
+    // Сколько готовых маршрутов держит кэш TransportRouter, 0 - кэш выключен
+    constexpr size_t DEFAULT_ROUTE_CACHE_SIZE = 4096;
+    // Больше альтернативных маршрутов на один запрос не ищется
+    constexpr size_t MAX_ROUTE_ALTERNATIVES = 16;
 
     struct RoutingSetting {
         double busWaitTime;
         double busVelocity;
+        RouterType routerType = RouterType::FloydWarshall;
+        size_t dijkstraCacheSize = DijkstraRouter::DEFAULT_CACHE_SIZE;
+        size_t cellSize = DEFAULT_CELL_SIZE;
+        GraphModel graphModel = GraphModel::Complete;
+        size_t routeCacheSize = DEFAULT_ROUTE_CACHE_SIZE;
     };
 
     struct SerializationSetting {
         std::string filename;
     };
 
-    namespace passenger_activity {
+    // Тип ребра графа и шага маршрута. Board, Ride и Alight - рёбра линейной модели,
+    // в готовом маршруте поездка по ним собирается в один шаг Bus
+    enum class RouteStepType : uint8_t {
+        Wait,
+        Bus,
+        Board,
+        Ride,
+        Alight
+    };
 
-        struct Activity {
+    // Плоская запись шага маршрута: время, id остановки ожидания или автобуса, число перегонов поездки
+    struct RouteStep {
+        RouteStepType type;
+        uint32_t spanCount;
+        double time;
+        uint32_t id;
 
-            Activity(double time);
-            virtual void WriteInJsonDict(json::Dict& dict);
+        static RouteStep OnWait(double time, uint32_t stopId);
+        static RouteStep OnBus(double time, uint32_t busId, uint32_t spanCount, RouteStepType type = RouteStepType::Bus);
+    };
 
-        private:
-            double time_;
-        };
+    // Имена остановки и автобуса берутся из справочника по id
+    void WriteInJsonDict(const RouteStep& routeStep, const TransportCatalogue& db, json::Dict& dict);
 
-        struct OnWait : Activity {
+    struct RouteInfo {
+        double totalTime;
+        std::vector<RouteStep> routeSteps;
+    };
 
-            OnWait(double time, const Stop* stop);
-            void WriteInJsonDict(json::Dict& dict) override ;
-        private:
-            const Stop* stop_;
-        };
+    // Для пользователя маршруты одинаковы, если совпадают остановки ожидания, автобусы и число перегонов
+    bool IsSameItinerary(const RouteInfo& lhs, const RouteInfo& rhs);
 
-        struct OnBus : Activity {
+    struct ParetoRouteInfo {
+        size_t transfers;
+        RouteInfo routeInfo;
+    };
 
-            OnBus(double time, const Bus* bus, int spanCount) ;
-            void WriteInJsonDict(json::Dict& dict) override ;
-        private:
-            const Bus* bus_;
-            int spanCount_;
-        };
-    }
+    struct ReachableStop {
+        const Stop* stop;
+        double totalTime;
+    };
 
-    using passenger_activity::Activity;
-    using passenger_activity::OnWait;
-    using passenger_activity::OnBus;
+    struct RouteCacheStatistics {
+        size_t hits;
+        size_t misses;
+        size_t size;
+    };
 
-    struct RouteInfo {
-        double totalTime;
-        std::vector<std::shared_ptr<Activity>> routeSteps;
+    // Неизменяемый маршрут, который кэш отдаёт без копирования; пустой optional - маршрута нет
+    using SharedRoute = std::shared_ptr<const std::optional<RouteInfo>>;
+
+    // Потокобезопасный LRU-кэш готовых маршрутов между парами остановок, хранит и отсутствие маршрута
+    class RouteCache {
+    public:
+        // Номера остановок отправления и назначения в старших и младших 32 битах
+        using Key = uint64_t;
+        using CachedRoute = SharedRoute;
+
+        explicit RouteCache(size_t capacity);
+
+        // nullptr, если маршрута в кэше нет
+        [[nodiscard]] CachedRoute Find(const Key& key);
+        void Insert(const Key& key, CachedRoute route);
+        [[nodiscard]] RouteCacheStatistics GetStatistics() const;
+
+    private:
+        size_t capacity_;
+        size_t hits_ = 0;
+        size_t misses_ = 0;
+
+        mutable std::mutex mutex_;
+        std::list<Key> recentlyUsed_;
+        std::unordered_map<Key, std::pair<CachedRoute, std::list<Key>::iterator>> routes_;
     };
 
+    // Времена в пути от каждой остановки-источника до каждой остановки-цели, nullopt - маршрута нет
+    using RouteMatrix = std::vector<std::vector<std::optional<double>>>;
+
     class TransportRouter {
 
+        // Вес ребра - waitCount ожиданий плюс время проезда distance метров, из них вес собирается
+        // заново для любых busWaitTime и busVelocity
+        struct EdgeComponents {
+            uint32_t waitCount;
+            double distance;
+        };
 
     public:
-        TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, const Graph& graph);
-        TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting);
+        TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, CompactGraphPtr graph,
+                        std::unique_ptr<RouterBase> router = nullptr,
+                        std::optional<ConnectionScanRouter> connectionScanRouter = std::nullopt);
+        TransportRouter(const TransportCatalogue& db, const RoutingSetting& routingSetting, size_t threadCount = 1);
         TransportRouter() = default;
 
-        [[nodiscard]] std::optional<RouteInfo> GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo) const;
-
-        [[nodiscard]] const Graph& GetGraph() const;
+        // Пересчитывает веса рёбер после изменения расстояний в справочнике и обновляет движок.
+        // Для Флойда-Уоршелла возвращает число пересчитанных строк таблицы маршрутов
+        std::optional<size_t> UpdateEdgeWeights(size_t threadCount = 1);
+
+        // Маршрут из кэша отдаётся тем же указателем, что хранится в кэше
+        [[nodiscard]] SharedRoute GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo) const;
+        // Оптимальный маршрут при других времени ожидания и скорости, без перестройки движка.
+        // Отрицательное ожидание или неположительная скорость - std::invalid_argument
+        [[nodiscard]] std::optional<RouteInfo> GetOptimalRoute(const std::string& routeFrom, const std::string& routeTo,
+                                                               const RoutingSetting& setting) const;
+        // До count разных маршрутов без циклов по возрастанию времени в пути, первый из них - оптимальный.
+        // Маршруты из разных рёбер с теми же остановками ожидания, автобусами и числом перегонов считаются одним
+        [[nodiscard]] std::vector<RouteInfo> GetAlternativeRoutes(const std::string& routeFrom, const std::string& routeTo,
+                                                                  size_t count, size_t threadCount = 1) const;
+        // Маршруты, которые нельзя улучшить ни по времени, ни по числу пересадок, по возрастанию числа пересадок
+        [[nodiscard]] std::vector<ParetoRouteInfo> GetParetoRoutes(const std::string& routeFrom, const std::string& routeTo) const;
+        // Маршрут по расписанию с отправлением не раньше departureTime (минуты от начала суток).
+        // Без расписания (ни у одного автобуса нет departures) бросает std::logic_error
+        [[nodiscard]] std::optional<RouteInfo> GetEarliestArrivalRoute(const std::string& routeFrom, const std::string& routeTo,
+                                                                       double departureTime) const;
+        // Только времена в пути, без шагов маршрута; строки матрицы считаются параллельно
+        [[nodiscard]] RouteMatrix GetRouteMatrix(const std::vector<std::string>& routesFrom, const std::vector<std::string>& routesTo,
+                                                 size_t threadCount = 1) const;
+        // Остановки, до которых можно добраться не дольше чем за timeBudget минут, по возрастанию времени в пути
+        [[nodiscard]] std::vector<ReachableStop> GetReachableStops(const std::string& stopName, double timeBudget) const;
+
+        [[nodiscard]] const CompactGraph& GetGraph() const;
         [[nodiscard]] const RoutingSetting& GetRoutingSetting() const;
+        [[nodiscard]] const RouterBase& GetRouter() const;
+        [[nodiscard]] bool HasTimetable() const;
+        [[nodiscard]] const ConnectionScanRouter& GetConnectionScanRouter() const;
+        [[nodiscard]] RouteCacheStatistics GetRouteCacheStatistics() const;
+        // Размеры меток, если движок - HubLabels
+        [[nodiscard]] std::optional<HubLabels::LabelStatistics> GetHubLabelStatistics() const;
 
     private:
         [[nodiscard]] double ComputeTimeInMinute (double sInMeters, double vInKmh) const;
-
-        void FillGraphWithStops(const std::deque<Stop>& stops, bool isGraphDeserialized = false);
-        void FillGraphWithBuses(const BusesContaner& buses, bool isGraphDeserialized = false);
-
-        std::map<int, std::shared_ptr<Activity>> edgeIds_;
-        std::map<const Stop*, size_t> vertexIds_;
-
-        std::optional<Graph> graph_;
+        [[nodiscard]] static size_t GetStopVertexId(const Stop* stop);
+        [[nodiscard]] double ComputeEdgeTime(graph::EdgeId edgeId, const RoutingSetting& setting) const;
+
+        // Без графа (при загрузке из базы) только восстанавливают соответствие рёбер и вершин остановкам и автобусам
+        void FillGraphWithStops(const std::deque<Stop>& stops, Graph* graph = nullptr);
+        void FillGraphWithBuses(const BusesContaner& buses, Graph* graph = nullptr);
+        void FillGraphWithBusSegments(const BusesContaner& buses, Graph* graph = nullptr);
+        [[nodiscard]] size_t ComputeVertexCount() const;
+        [[nodiscard]] CompactGraphPtr BuildGraph();
+        void BuildRouter(size_t threadCount = 1);
+        [[nodiscard]] std::vector<PartitionOverlay::CellId> ComputeStopCells() const;
+        // Без customSetting берутся времена шагов, посчитанные при построении графа
+        [[nodiscard]] RouteInfo ConvertRoute(const RouterBase::RouteInfo& graphRouteInfo,
+                                             const std::optional<RoutingSetting>& customSetting = std::nullopt) const;
+        [[nodiscard]] RouteInfo ConvertJourney(const RaptorRouter::Journey& journey, double busWaitTime) const;
+        [[nodiscard]] std::optional<RouteInfo> ComputeOptimalRoute(const Stop* stopFrom, const Stop* stopTo) const;
+        void ResetRouteCache();
+        // Для движка Raptor строит RAPTOR сразу, для остальных только сбрасывает
+        void ResetRaptor();
+        // Строит Connection Scan, только если хотя бы у одного автобуса есть расписание
+        void ResetConnectionScanRouter();
+        [[nodiscard]] const RaptorRouter& GetRaptor() const;
+
+        // Шаг маршрута, соответствующий ребру, по номеру ребра
+        std::vector<RouteStep> edgeSteps_;
+        std::vector<EdgeComponents> edgeComponents_;
+        // Только для линейной модели: остановки вершин "в салоне" начиная с 2 * число остановок
+        std::vector<const Stop*> onBoardStops_;
+
+        // Один неизменяемый граф на TransportRouter и движок маршрутизации
+        CompactGraphPtr graph_;
         std::optional<RoutingSetting> routingSetting_;
-        std::unique_ptr<Router> router_;
+        std::unique_ptr<RouterBase> router_;
+        // RAPTOR нужен движку Raptor и запросам pareto; при других движках строится при первом таком запросе
+        mutable std::optional<RaptorRouter> raptor_;
+        std::unique_ptr<std::mutex> raptorMutex_ = std::make_unique<std::mutex>();
+        std::optional<ConnectionScanRouter> connectionScanRouter_;
+        // Кэш за указателем, чтобы TransportRouter оставался перемещаемым
+        std::unique_ptr<RouteCache> routeCache_;
 
         std::optional<const TransportCatalogue*> db_;
     };
 
+    namespace tests {
+        void AlternativeRoutesAreDistinct();
+        void EnginesMatchFloydWarshall();
+        void UpdatedWeightsMatchRebuild();
+        void RouteCacheEvictsLeastRecentlyUsed();
+    }
+
 }